@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+
+#include "clauncher-supply.hpp"
+
+namespace LNCR {
+
+// Passes log records to sink from a dedicated thread. Logging thread only
+// copies record into a preallocated lock-free ring buffer.
+class AsyncLogger {
+ public:
+  enum OverflowPolicy { Drop, Block };
+
+  AsyncLogger(logging_foo sink, size_t capacity = 4096,
+              OverflowPolicy overflow_policy = Drop);
+  // passes all queued records to sink
+  ~AsyncLogger();
+
+  // logging_foo to pass to launcher objects, valid while the object exists
+  const logging_foo& GetLogger() const noexcept;
+  uint64_t GetDropped() const noexcept;
+
+ private:
+  struct Implementation;
+  std::unique_ptr<Implementation> implementation_;
+};
+
+}  // namespace LNCR
\ No newline at end of file
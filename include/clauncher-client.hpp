@@ -1,5 +1,7 @@
 #pragma once
 
+#include <functional>
+#include <map>
 #include <memory>
 #include <optional>
 #include <string>
@@ -10,15 +12,42 @@ namespace LNCR {
 
 class LauncherClient {
  public:
-  LauncherClient(int port, logging_foo = LoggerCap);
+  // use_cache: keep process statuses locally, invalidated by server events
+  LauncherClient(int port, logging_foo = LoggerCap, bool use_cache = false);
   ~LauncherClient();
 
+  // throw LauncherException if deadline is exceeded or wait is cancelled
   bool LoadProcess(const std::string& bin_name,
-                   const ProcessConfig& process_config, bool wait_for_run);
-  TermStatus StopProcess(const std::string& bin_name, bool wait_for_stop);
-  bool ReRunProcess(const std::string& bin_name, bool wait_for_rerun);
-  bool IsProcessRunning(const std::string& bin_name);
-  std::optional<int> GetProcessPid(const std::string& bin_name);
+                   const ProcessConfig& process_config, bool wait_for_run,
+                   const Deadline& deadline = {});
+  // TermTimeout if deadline is exceeded while waiting, TermCancelled if wait
+  // is cancelled. Throws LauncherException only if the deadline has passed
+  // before the request or the server does not answer in time
+  TermStatus StopProcess(const std::string& bin_name, bool wait_for_stop,
+                         const Deadline& deadline = {});
+  // throw LauncherException if deadline is exceeded or wait is cancelled
+  bool ReRunProcess(const std::string& bin_name, bool wait_for_rerun,
+                    const Deadline& deadline = {});
+  bool IsProcessRunning(const std::string& bin_name,
+                        const Deadline& deadline = {});
+  std::optional<int> GetProcessPid(const std::string& bin_name,
+                                   const Deadline& deadline = {});
+  // releases pending wait_for_run / wait_for_stop of the process
+  bool CancelWaits(const std::string& bin_name, const Deadline& deadline = {});
+  ServerStats GetStats(const Deadline& deadline = {});
+  // Chrome / Perfetto trace JSON of recent launches
+  std::string GetTrace(const Deadline& deadline = {});
+  // server rereads its config file and applies the difference
+  std::map<std::string, ApplyResult> ReloadConfig(
+      const Deadline& deadline = {});
+  // converges the server to exactly the desired processes: starts, stops and
+  // restarts up to max_parallel processes at once
+  std::map<std::string, ApplyResult> ApplyDesiredState(
+      const std::map<std::string, ProcessConfig>& desired,
+      size_t max_parallel = 16, const Deadline& deadline = {});
+
+  // blocks streaming process events until handler returns false
+  void Subscribe(const std::function<bool(const ProcessEvent&)>& handler);
 
  private:
   struct Implementation;
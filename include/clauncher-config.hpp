@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+#include <istream>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "clauncher-supply.hpp"
+
+namespace LNCR {
+
+using BootConfig = std::map<std::string, ProcessConfig>;
+
+const uint32_t kConfigVersion = 1;
+
+// versioned checksummed binary format of the boot config file
+std::string SerializeConfig(const BootConfig& boot_config);
+// false if data is not a config of a supported version or is damaged
+bool DeserializeConfig(std::string_view data, BootConfig& boot_config);
+
+// maps the file to memory; text format files are imported
+bool ReadConfigFile(const std::string& path, BootConfig& boot_config);
+
+// text format (one entry per line, args must not contain whitespaces)
+std::string ExportTextConfig(const BootConfig& boot_config);
+bool ImportTextConfig(std::istream& stream, BootConfig& boot_config);
+
+// checksummed binary records of the boot config journal
+std::string SerializeJournalSet(const std::string& bin_name,
+                                const ProcessConfig& config);
+std::string SerializeJournalErase(const std::string& bin_name);
+// applies complete records in order, stops at the first torn or damaged one.
+// Returns number of applied records
+size_t ReplayJournal(std::string_view data, BootConfig& boot_config,
+                     bool& is_torn);
+size_t ReadJournalFile(const std::string& path, BootConfig& boot_config,
+                       bool& is_torn);
+
+// process left running by the previous server instance
+struct HandoverEntry {
+  std::string bin_name;
+  ProcessConfig config;
+  int pid = 0;
+  uint64_t start_time = 0;  // clock ticks since boot, /proc/<pid>/stat
+};
+
+// checksummed binary format of the handover file, same layout rules as
+// the config file
+std::string SerializeHandover(const std::vector<HandoverEntry>& entries);
+bool DeserializeHandover(std::string_view data,
+                         std::vector<HandoverEntry>& entries);
+bool ReadHandoverFile(const std::string& path,
+                      std::vector<HandoverEntry>& entries);
+
+}  // namespace LNCR
\ No newline at end of file
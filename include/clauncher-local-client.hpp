@@ -0,0 +1,45 @@
+#pragma once
+
+#include <map>
+#include <optional>
+#include <string>
+
+#include "clauncher-server.hpp"
+#include "clauncher-supply.hpp"
+
+namespace LNCR {
+
+// same interface as LauncherClient, but calls the server in-process
+class LauncherLocalClient {
+ public:
+  LauncherLocalClient(LauncherServer& server);
+
+  // throw LauncherException if deadline is exceeded or wait is cancelled
+  bool LoadProcess(const std::string& bin_name,
+                   const ProcessConfig& process_config, bool wait_for_run,
+                   const Deadline& deadline = {});
+  // TermTimeout if deadline is exceeded while waiting, TermCancelled if wait
+  // is cancelled. Throws LauncherException if the deadline has already passed
+  TermStatus StopProcess(const std::string& bin_name, bool wait_for_stop,
+                         const Deadline& deadline = {});
+  // throw LauncherException if deadline is exceeded or wait is cancelled
+  bool ReRunProcess(const std::string& bin_name, bool wait_for_rerun,
+                    const Deadline& deadline = {});
+  bool IsProcessRunning(const std::string& bin_name,
+                        const Deadline& deadline = {});
+  std::optional<int> GetProcessPid(const std::string& bin_name,
+                                   const Deadline& deadline = {});
+  bool CancelWaits(const std::string& bin_name, const Deadline& deadline = {});
+  ServerStats GetStats(const Deadline& deadline = {});
+  std::string GetTrace(const Deadline& deadline = {});
+  std::map<std::string, ApplyResult> ReloadConfig(
+      const Deadline& deadline = {});
+  std::map<std::string, ApplyResult> ApplyDesiredState(
+      const std::map<std::string, ProcessConfig>& desired,
+      size_t max_parallel = 16, const Deadline& deadline = {});
+
+ private:
+  LauncherServer::Implementation* implementation_;
+};
+
+}  // namespace LNCR
\ No newline at end of file
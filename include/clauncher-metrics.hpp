@@ -0,0 +1,101 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace LNCR {
+
+struct LatencyStats {
+  uint64_t count = 0;
+  std::chrono::nanoseconds mean = {};
+  std::chrono::nanoseconds p50 = {};
+  std::chrono::nanoseconds p90 = {};
+  std::chrono::nanoseconds p99 = {};
+  std::chrono::nanoseconds p999 = {};
+  std::chrono::nanoseconds max = {};
+};
+
+// Log-linear (HDR-like) histogram: 16 buckets per power of two, so reported
+// percentiles are at most 1/16 above the real value. Recording is lock-free.
+class LatencyHistogram {
+ public:
+  LatencyHistogram() = default;
+  LatencyHistogram(const LatencyHistogram&) = delete;
+
+  void Record(std::chrono::nanoseconds latency) noexcept;
+  LatencyStats GetStats() const noexcept;
+
+ private:
+  static const int kSubBucketBits = 4;
+  static const int kSubBuckets = 1 << kSubBucketBits;
+  static const int kBuckets = 64 * kSubBuckets;
+
+  static int GetBucket(uint64_t value) noexcept;
+  static uint64_t GetBucketTop(int bucket) noexcept;
+
+  std::atomic<uint64_t> buckets_[kBuckets] = {};
+  std::atomic<uint64_t> count_ = 0;
+  std::atomic<uint64_t> sum_ = 0;
+  std::atomic<uint64_t> max_ = 0;
+};
+
+struct ActionStats {
+  std::string module;
+  std::string action;
+  uint64_t calls;
+  LatencyStats latency;
+};
+
+struct MutexStats {
+  std::string name;
+  uint64_t acquisitions = 0;
+  uint64_t contended = 0;  // acquisitions that had to wait for the owner
+};
+
+// drop-in replacement of std::mutex counting contended acquisitions
+class CountedMutex {
+ public:
+  void lock();
+  bool try_lock() noexcept;
+  void unlock() noexcept;
+
+  MutexStats GetStats(const std::string& name) const noexcept;
+
+ private:
+  std::mutex mutex_;
+  std::atomic<uint64_t> acquisitions_ = 0;
+  std::atomic<uint64_t> contended_ = 0;
+};
+
+struct ServerStats {
+  std::chrono::milliseconds uptime = {};
+
+  // table sizes
+  uint64_t load_config = 0;
+  uint64_t running = 0;
+  uint64_t to_run = 0;
+  uint64_t to_terminate = 0;
+
+  uint64_t clients = 0;
+  uint64_t subscribers = 0;
+
+  uint64_t launches = 0;  // agents spawned, including relaunches
+  uint64_t restarts = 0;  // reruns of exited processes with term_rerun
+  uint64_t watchdog_timeouts = 0;  // processes stopped for missed heartbeats
+  uint64_t idle_stops = 0;  // on demand processes stopped as idle
+  uint64_t throttled_launches = 0;  // launches delayed by admission control
+  double launches_per_second = 0;
+
+  LatencyStats spawn_latency;  // agent spawn to handshake, or spawner exec
+  LatencyStats stop_latency;   // stop request to process termination
+  LatencyStats control_loop;   // one iteration of the process control loop
+
+  std::vector<MutexStats> mutexes;
+  std::vector<ActionStats> actions;
+};
+
+}  // namespace LNCR
\ No newline at end of file
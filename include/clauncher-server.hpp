@@ -1,22 +1,55 @@
 #pragma once
 
+#include <map>
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "clauncher-supply.hpp"
 
 namespace LNCR {
 
+class LauncherLocalClient;
+
 class LauncherServer {
  public:
   // constructor / destructor //
+  // cgroup_root: delegated cgroup v2 directory, every process is placed
+  // into its own child cgroup, which is killed with the process
   LauncherServer(int port, const std::string& config_file,
-                 const std::string& agent_binary, logging_foo = LoggerCap);
+                 const std::string& agent_binary, logging_foo = LoggerCap,
+                 const std::string& cgroup_root = {});
   ~LauncherServer();
 
+  // per-action call counters and latencies of every server in the process
+  std::vector<ActionStats> GetActionStats() const;
+  // tables, latencies and contention snapshot of this server
+  ServerStats GetStats() const;
+  // launch phases of recent launches as Chrome / Perfetto trace JSON
+  std::string GetTrace() const;
+  // applies config file with journal: starts added, stops removed and
+  // restarts changed processes, unchanged ones are untouched
+  std::map<std::string, ApplyResult> ReloadConfig();
+  // see LauncherClient::ApplyDesiredState
+  std::map<std::string, ApplyResult> ApplyDesiredState(
+      const std::map<std::string, ProcessConfig>& desired,
+      size_t max_parallel = 16, const Deadline& deadline = {});
+  // destructor leaves running processes alive and saves them for the next
+  // server with the same config file, which re-adopts them
+  void EnableHandover();
+  // global launch rate limit and pressure gating, applied to the next
+  // launches; queued ones wait and are admitted in priority order
+  void SetAdmissionControl(const AdmissionConfig& config);
+  // Stops serving and terminates all processes at once. Processes are killed
+  // at the deadline (30 s by default), or after their time_to_stop if it is
+  // earlier. Called by the destructor if not called before
+  std::vector<StopTiming> Shutdown(const Deadline& deadline = {});
+
  private:
   struct Implementation;
   std::unique_ptr<Implementation> implementation_;
+
+  friend class LauncherLocalClient;
 };
 
 void LauncherRunner(int port, const std::string& config_file,
@@ -1,29 +1,106 @@
 #pragma once
 
 #include <chrono>
+#include <exception>
 #include <functional>
 #include <list>
 #include <string>
+#include <string_view>
 #include <optional>
+#include <type_traits>
+#include <vector>
+
+#include "clauncher-metrics.hpp"
+
+// messages with greater priority are compiled out
+#ifndef LNCR_LOG_PRIORITY
+#define LNCR_LOG_PRIORITY 3
+#endif
 
 namespace LNCR {
 
 enum MessagePriority { Error = 0, Warning = 1, Info = 2, Debug = 3 };
+const int kMaxLogPriority = LNCR_LOG_PRIORITY;
+
 using logging_foo = std::function<void(const std::string&, const std::string&,
                                        const std::string&, int)>;
 void LoggerCap(const std::string& l_module, const std::string& l_action,
                const std::string& l_event, int priority);
 
+// messages with greater priority are skipped before formatting
+void SetLogPriority(int priority) noexcept;
+// per window, every log call site passes at most burst messages and each
+// distinct message once; the rest is reported as "N similar messages
+// suppressed". Errors are never suppressed, zero window disables suppression
+void SetLogSuppression(std::chrono::milliseconds window, int burst) noexcept;
+
+inline void AppendLogArg(std::string& event, const std::string& arg) {
+  event += arg;
+}
+inline void AppendLogArg(std::string& event, std::string_view arg) {
+  event += arg;
+}
+inline void AppendLogArg(std::string& event, const char* arg) {
+  event += arg;
+}
+template <typename T>
+  requires(std::is_arithmetic_v<T> || std::is_enum_v<T>)
+void AppendLogArg(std::string& event, T arg) {
+  if constexpr (std::is_enum_v<T>) {
+    event += std::to_string(static_cast<int>(arg));
+  } else {
+    event += std::to_string(arg);
+  }
+}
+
+// replaces every "{}" of format with the next argument
+inline void FormatLog(std::string& event, std::string_view format) {
+  event += format;
+}
+template <typename Arg, typename... Args>
+void FormatLog(std::string& event, std::string_view format, const Arg& arg,
+               const Args&... args) {
+  auto pos = format.find("{}");
+  if (pos == std::string_view::npos) {
+    event += format;
+    return;
+  }
+  event += format.substr(0, pos);
+  AppendLogArg(event, arg);
+  FormatLog(event, format.substr(pos + 2), args...);
+}
+
 class Logger {
  public:
-  void Log(const std::string& event, int priority);
+  template <typename... Args>
+  void Log(int priority, std::string_view format, const Args&... args) {
+    if (priority > kMaxLogPriority || priority > max_priority_) {
+      return;
+    }
+    std::string& event = EventBuffer();
+    event.clear();
+    FormatLog(event, format, args...);
+    Write(format, event, priority);
+  }
+  bool IsEnabled(int priority) const noexcept;
 
-  virtual std::string GetModule() const = 0;
-  virtual std::string GetAction() const = 0;
+  virtual const char* GetModule() const = 0;
+  virtual const char* GetAction() const = 0;
 
  protected:
-  logging_foo logger_;
+  // logger must outlive the object
+  Logger(const logging_foo& logger);
+
+  const logging_foo* logger_;
+  int max_priority_ = -1;
   virtual std::string GetID() const;
+
+ private:
+  static std::string& EventBuffer() noexcept;
+  bool IsSuppressed(std::string_view format, const std::string& event,
+                    int& suppressed) const noexcept;
+  void Write(std::string_view format, const std::string& event,
+             int priority) const;
 };
 
 class LServer : public Logger {
@@ -52,17 +129,64 @@ class LServer : public Logger {
     PrCtrlMain,
     IsPidAvail,
     GetPid,
-    IsRunning
+    IsRunning,
+    ASubscribe,
+    NotifySubscribers,
+    ACancel,
+    CancelWaits,
+    RerunProcess,
+    AGetStats,
+    AGetTrace,
+    SyncJournal,
+    CompactConfig,
+    UpdateBootConfig,
+    ReloadConfig,
+    AReload,
+    DiffState,
+    ApplyDiff,
+    ApplyDesiredState,
+    AApplyState,
+    Handover,
+    AdoptProcesses,
+    Shutdown,
+    StopAll,
+    RollingRestart,
+    PrCtrlRetiring,
+    Listeners,
+    Cgroups,
+    Notifier,
+    Watchdog,
+    Activator,
+    Idle,
+    Spawner,
+    Admission,
+    ActionsNum
   };
-  LServer(LAction action, logging_foo logger);
+  LServer(LAction action, const logging_foo& logger);
+  LServer(LAction action, logging_foo&& logger) = delete;
+  // copy shares the call id, but does not record the latency
+  LServer(const LServer& other);
+  ~LServer();
 
-  std::string GetModule() const override;
-  std::string GetAction() const override;
+  const char* GetModule() const override;
+  const char* GetAction() const override;
+
+  // number of calls and latency from object creation to destruction
+  static std::vector<ActionStats> GetStats();
 
  private:
+  struct alignas(64) ActionMetrics {
+    std::atomic<uint64_t> calls = 0;
+    LatencyHistogram latency;
+  };
+
   LAction action_;
+  uint64_t id_;
+  std::optional<std::chrono::steady_clock::time_point> start_;
   std::string GetID() const override;
-  static int64_t calls[24];
+  static const char* GetActionName(LAction action);
+
+  static ActionMetrics metrics[ActionsNum];
 };
 
 class LClient : public Logger {
@@ -75,28 +199,45 @@ class LClient : public Logger {
     ReRunProcess,
     IsProcessRunning,
     GetProcessPid,
-    CheckTcpClient
+    CheckTcpClient,
+    Subscribe,
+    CacheUpdater,
+    CancelWaits,
+    GetStats,
+    GetTrace,
+    ReloadConfig,
+    ApplyDesiredState
   };
 
-  LClient(LAction action, logging_foo logger);
-  std::string GetModule() const override;
-  std::string GetAction() const override;
+  LClient(LAction action, const logging_foo& logger);
+  LClient(LAction action, logging_foo&& logger) = delete;
+  const char* GetModule() const override;
+  const char* GetAction() const override;
 
  private:
   LAction action_;
 };
 class LRunner : public Logger {
  public:
-  enum LAction { Main, SigHandler };
+  enum LAction { Main, SigHandler, Reloader };
 
-  LRunner(LAction action, logging_foo logger);
-  std::string GetModule() const override;
-  std::string GetAction() const override;
+  LRunner(LAction action, const logging_foo& logger);
+  LRunner(LAction action, logging_foo&& logger) = delete;
+  const char* GetModule() const override;
+  const char* GetAction() const override;
 
  private:
   LAction action_;
 };
 
+// token bucket: up to burst launches at once, then one per interval
+struct RateLimit {
+  std::chrono::milliseconds interval = std::chrono::milliseconds(1000);
+  uint32_t burst = 1;
+
+  bool operator==(const RateLimit&) const = default;
+};
+
 struct ProcessConfig {
   std::list<std::string> args;
 
@@ -104,10 +245,75 @@ struct ProcessConfig {
   bool term_rerun;
 
   std::optional<std::chrono::milliseconds> time_to_stop;
+
+  // rerun starts the new instance first and stops the old one after it
+  bool rolling_restart = false;
+  // tcp ports listened by the launcher, passed to every instance as
+  // LISTEN_FDS sockets starting from descriptor 3
+  std::vector<uint16_t> listen_ports = {};
+  // run only opens listen_ports, the process is spawned on the first
+  // connection and waits for the next one when it has exited
+  bool on_demand = false;
+  // on demand process which has used no cpu and had no connections on
+  // listen_ports for this long is stopped until the next connection
+  std::optional<std::chrono::milliseconds> idle_timeout = {};
+  // queued launches are admitted in priority order, greater first
+  int priority = 0;
+  // launches of the process, reruns included
+  std::optional<RateLimit> launch_limit = {};
+  // process reports READY=1 to NOTIFY_SOCKET (sd_notify protocol); it is
+  // run only then, and killed if not ready in time
+  std::optional<std::chrono::milliseconds> ready_timeout = {};
+  // process sends WATCHDOG=1 to NOTIFY_SOCKET at least this often; a hung
+  // one is stopped (SIGTERM, SIGKILL after time_to_stop) and rerun if
+  // term_rerun is set
+  std::optional<std::chrono::milliseconds> watchdog_interval = {};
+
+  bool operator==(const ProcessConfig&) const = default;
+};
+
+// launch admission of the server, nothing is limited by default
+struct AdmissionConfig {
+  std::optional<RateLimit> launch_limit = {};  // all launches
+  // launches wait while "some avg10" of /proc/pressure/memory (cpu) is
+  // above the limit, percent
+  std::optional<double> memory_pressure = {};
+  std::optional<double> cpu_pressure = {};
 };
 
 enum SenderStatus { Agent, Client };
-enum Command { Load, Stop, Rerun, IsRunning, GetPid, GetConfig, SetConfig };
+
+// pre-forked spawner: the agent binary run with kSpawnerArg serves spawn
+// requests of the server on kSpawnerFd (SOCK_SEQPACKET socket). Request is
+// [SpawnHeader][cgroup.procs path][args][env], every string '\0'
+// terminated, with listening sockets as SCM_RIGHTS; reply is SpawnReply
+const char kSpawnerArg[] = "--spawner";
+const int kSpawnerFd = 3;
+const size_t kSpawnRequestMax = 128 * 1024;
+const size_t kSpawnFdsMax = 64;
+struct SpawnHeader {
+  uint32_t args_num;  // args[0] is the path of binary
+  uint32_t env_num;
+};
+struct SpawnReply {
+  int32_t pid;
+  int32_t error;  // errno of exec, the process has exited if set
+};
+enum Command {
+  Load,
+  Stop,
+  Rerun,
+  IsRunning,
+  GetPid,
+  Subscribe,
+  Cancel,
+  GetStats,
+  GetTrace,
+  Reload,
+  ApplyState,
+  GetConfig,
+  SetConfig
+};
 
 enum TermStatus {
   NoCheck,
@@ -116,7 +322,70 @@ enum TermStatus {
   AlreadyTerminating,
   NotRun,
   NotRunning,
-  TermError
+  TermError,
+  TermTimeout,
+  TermCancelled
+};
+
+enum RunStatus { RunFailed, RunSucceeded, RunTimeout, RunCancelled };
+
+using Deadline =
+    std::optional<std::chrono::time_point<std::chrono::system_clock>>;
+
+// LoadProcess / ReRunProcess result, throws LauncherException if not finished
+bool ToRunResult(int run_status);
+
+class LauncherException : public std::exception {
+ public:
+  enum ExceptionType { DeadlineExceeded, Cancelled };
+
+  LauncherException(ExceptionType type);
+  const char* what() const noexcept override;
+  ExceptionType GetType() const noexcept;
+
+ private:
+  ExceptionType type_;
+};
+
+enum ProcessEventType {
+  Started,            // value: pid
+  Exited,             // value: pid of the process that has gone
+  Restarting,         // value: pid of the process that has gone
+  Killed,             // value: TermStatus
+  LoadConfigChanged,  // value: launch on boot
+  Launching,          // value: 0
+  QueueOverflow,      // value: number of lost events
+  Ready,              // value: pid
+  WatchdogTimeout,    // value: pid
+  Activated,          // value: port of the first connection
+  Idle                // value: pid of the process being stopped
+};
+
+struct ProcessEvent {
+  ProcessEventType type;
+  std::string bin_name;
+  int value;
+};
+
+// what is done to a process to reach the requested state
+enum ApplyAction {
+  ApplyUnchanged,
+  ApplyStart,
+  ApplyStop,
+  ApplyRestart,      // stop and start with the new config
+  ApplyReconfigure   // config is changed without a restart
+};
+struct ApplyResult {
+  ApplyAction action = ApplyUnchanged;
+  bool is_succeeded = true;
+};
+
+// termination of a process during server shutdown
+struct StopTiming {
+  std::string bin_name;
+  int pid = 0;
+  TermStatus status = NoCheck;  // SigTerm: exited, SigKill: killed
+  std::chrono::milliseconds duration = {};  // from shutdown start
 };
 
 }  // namespace LNCR
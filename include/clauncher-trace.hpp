@@ -0,0 +1,54 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+
+namespace LNCR {
+
+// environment variable passing trace id of the launch to the agent
+const char kTraceIdEnv[] = "LNCR_TRACE_ID";
+
+struct TraceContext {
+  uint64_t trace_id = 0;
+  // start of the request, e.g. client send time
+  std::optional<std::chrono::time_point<std::chrono::system_clock>> started =
+      {};
+};
+
+uint64_t NewTraceId() noexcept;
+// microseconds since epoch, comparable between processes of the host
+int64_t ToTraceTime(
+    std::chrono::time_point<std::chrono::system_clock> time) noexcept;
+std::chrono::time_point<std::chrono::system_clock> FromTraceTime(
+    int64_t time) noexcept;
+
+// Fixed-size ring of spans, the oldest spans are overwritten. Recording takes
+// no allocation and no global lock.
+class TraceBuffer {
+ public:
+  TraceBuffer(size_t capacity = 8192);
+  TraceBuffer(const TraceBuffer&) = delete;
+  ~TraceBuffer();
+
+  // phase must be a string literal
+  void Record(uint64_t trace_id, const char* phase,
+              const std::string& bin_name,
+              std::chrono::time_point<std::chrono::system_clock> start,
+              std::chrono::time_point<std::chrono::system_clock> end) noexcept;
+
+  // Chrome / Perfetto trace event JSON, one track per trace id
+  std::string GetChromeTrace() const;
+
+ private:
+  struct Slot;
+
+  size_t capacity_;
+  std::unique_ptr<Slot[]> slots_;
+  std::atomic<uint64_t> next_ = 0;
+};
+
+}  // namespace LNCR
\ No newline at end of file
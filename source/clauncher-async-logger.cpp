@@ -0,0 +1,191 @@
+#include "clauncher-async-logger.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <thread>
+
+namespace LNCR {
+
+const std::chrono::milliseconds kDrainWait = std::chrono::milliseconds(1);
+const size_t kModuleSize = 32;
+const size_t kActionSize = 96;
+const size_t kEventSize = 256;
+
+struct AsyncLogger::Implementation {
+  struct Record {
+    char module[kModuleSize];
+    char action[kActionSize];
+    char event[kEventSize];
+    uint16_t module_size;
+    uint16_t action_size;
+    uint16_t event_size;
+    int priority;
+  };
+  struct Cell {
+    std::atomic<size_t> sequence;
+    Record record;
+  };
+
+  Implementation(logging_foo&& sink, size_t capacity,
+                 OverflowPolicy overflow_policy);
+
+  bool Push(const std::string& module, const std::string& action,
+            const std::string& event, int priority) noexcept;
+  bool Pop() noexcept;
+  void Drainer() noexcept;
+
+  logging_foo sink_;
+  logging_foo logger_;
+  OverflowPolicy overflow_policy_;
+
+  size_t mask_;
+  std::unique_ptr<Cell[]> cells_;
+  alignas(64) std::atomic<size_t> enqueue_pos_ = 0;
+  alignas(64) size_t dequeue_pos_ = 0;
+
+  std::atomic<uint64_t> dropped_ = 0;
+  uint64_t reported_dropped_ = 0;
+
+  std::string module_;
+  std::string action_;
+  std::string event_;
+
+  std::atomic<bool> is_active_ = true;
+  std::thread drainer_;
+};
+
+void CopyTruncated(char* to, uint16_t& to_size, size_t capacity,
+                   const std::string& from) {
+  to_size = std::min(capacity, from.size());
+  std::memcpy(to, from.data(), to_size);
+}
+
+AsyncLogger::Implementation::Implementation(logging_foo&& sink,
+                                            size_t capacity,
+                                            OverflowPolicy overflow_policy)
+    : sink_(std::move(sink)), overflow_policy_(overflow_policy) {
+  size_t size = 1;
+  while (size < std::max<size_t>(capacity, 2)) {
+    size <<= 1;
+  }
+  mask_ = size - 1;
+  cells_.reset(new Cell[size]);
+  for (size_t i = 0; i < size; ++i) {
+    cells_[i].sequence.store(i, std::memory_order_relaxed);
+  }
+
+  logger_ = [this](const std::string& module, const std::string& action,
+                   const std::string& event, int priority) {
+    while (!Push(module, action, event, priority)) {
+      if (overflow_policy_ == Drop) {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        return;
+      }
+      std::this_thread::yield();
+    }
+  };
+}
+
+bool AsyncLogger::Implementation::Push(const std::string& module,
+                                       const std::string& action,
+                                       const std::string& event,
+                                       int priority) noexcept {
+  Cell* cell;
+  size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+  while (true) {
+    cell = &cells_[pos & mask_];
+    size_t sequence = cell->sequence.load(std::memory_order_acquire);
+    auto diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+    if (diff == 0) {
+      if (enqueue_pos_.compare_exchange_weak(pos, pos + 1,
+                                             std::memory_order_relaxed)) {
+        break;
+      }
+    } else if (diff < 0) {
+      return false;  // buffer is full
+    } else {
+      pos = enqueue_pos_.load(std::memory_order_relaxed);
+    }
+  }
+
+  auto& record = cell->record;
+  CopyTruncated(record.module, record.module_size, kModuleSize, module);
+  CopyTruncated(record.action, record.action_size, kActionSize, action);
+  CopyTruncated(record.event, record.event_size, kEventSize, event);
+  record.priority = priority;
+
+  cell->sequence.store(pos + 1, std::memory_order_release);
+  return true;
+}
+
+bool AsyncLogger::Implementation::Pop() noexcept {
+  Cell* cell = &cells_[dequeue_pos_ & mask_];
+  if (cell->sequence.load(std::memory_order_acquire) != dequeue_pos_ + 1) {
+    return false;  // buffer is empty or record is being written
+  }
+
+  auto& record = cell->record;
+  module_.assign(record.module, record.module_size);
+  action_.assign(record.action, record.action_size);
+  event_.assign(record.event, record.event_size);
+  int priority = record.priority;
+
+  cell->sequence.store(dequeue_pos_ + mask_ + 1, std::memory_order_release);
+  ++dequeue_pos_;
+
+  try {
+    sink_(module_, action_, event_, priority);
+  } catch (...) {
+  }
+  return true;
+}
+
+void AsyncLogger::Implementation::Drainer() noexcept {
+  while (true) {
+    bool is_active = is_active_.load();
+    while (Pop()) {
+    }
+
+    uint64_t dropped = dropped_.load(std::memory_order_relaxed);
+    if (dropped != reported_dropped_) {
+      try {
+        sink_("ASYNC LOGGER", "DRAINER",
+              std::to_string(dropped - reported_dropped_) +
+                  " messages dropped: buffer is full",
+              Warning);
+      } catch (...) {
+      }
+      reported_dropped_ = dropped;
+    }
+
+    if (!is_active) {
+      return;
+    }
+    std::this_thread::sleep_for(kDrainWait);
+  }
+}
+
+AsyncLogger::AsyncLogger(logging_foo sink, size_t capacity,
+                         OverflowPolicy overflow_policy)
+    : implementation_(std::make_unique<Implementation>(
+          std::move(sink), capacity, overflow_policy)) {
+  implementation_->drainer_ =
+      std::thread(&Implementation::Drainer, implementation_.get());
+}
+
+AsyncLogger::~AsyncLogger() {
+  implementation_->is_active_ = false;
+  implementation_->drainer_.join();
+}
+
+const logging_foo& AsyncLogger::GetLogger() const noexcept {
+  return implementation_->logger_;
+}
+
+uint64_t AsyncLogger::GetDropped() const noexcept {
+  return implementation_->dropped_.load(std::memory_order_relaxed);
+}
+
+}  // namespace LNCR
\ No newline at end of file
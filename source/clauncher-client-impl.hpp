@@ -1,17 +1,73 @@
 #pragma once
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <unordered_map>
+
 #include "clauncher-client.hpp"
 #include "clauncher-supply.hpp"
 #include "tcp-client.hpp"
 
 namespace LNCR {
 
+const std::chrono::milliseconds kDeadlineGrace = std::chrono::milliseconds(100);
+
 struct LauncherClient::Implementation {
+  struct Cache {
+    std::unordered_map<std::string, std::optional<int>> pids = {};
+    std::unordered_map<std::string, bool> running = {};
+    uint64_t generation = 0;
+    bool is_valid = false;
+  };
+
   void CheckTcpClient();
+  void Subscribe(const std::function<bool(const ProcessEvent&)>& handler,
+                 const std::function<void()>& on_subscribed = {},
+                 const std::atomic<bool>* is_active = nullptr);
+  void CacheUpdater() noexcept;
+  // drops cached answers of the process, of every process if empty
+  void InvalidateCache(const std::string& bin_name = {}) noexcept;
+
+  int64_t DeadlineToTimeout(const Deadline& deadline) const;
+  LatencyStats ReceiveLatency(const Deadline& deadline, Logger& logger);
+  // rolling restart, listening ports and readiness following the args
+  void SendLaunchOptions(const ProcessConfig& config);
+  std::map<std::string, ApplyResult> ReceiveApplyResults(
+      const Deadline& deadline, Logger& logger);
+  template <typename... Args>
+  void ReceiveAnswer(const Deadline& deadline, Logger& logger, Args&... args) {
+    while (true) {
+      int timeout = tcp_client_->GetMsPingThreshold();
+      if (deadline.has_value()) {
+        auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+            deadline.value() + kDeadlineGrace -
+            std::chrono::system_clock::now());
+        if (left.count() <= 0) {
+          logger.Log(Warning, "Deadline exceeded. Dropping connection");
+          delete tcp_client_;
+          tcp_client_ = nullptr;
+          throw LauncherException(LauncherException::DeadlineExceeded);
+        }
+        timeout = std::min<int64_t>(timeout, left.count());
+      }
+      if (tcp_client_->Receive(timeout, args...)) {
+        return;
+      }
+    }
+  }
 
   int port_;
   logging_foo logger_;
   TCP::TcpClient* tcp_client_ = nullptr;
+
+  Cache cache_ = {};
+  std::mutex cache_m_;
+  std::optional<std::thread> cache_updater_ = {};
+  std::atomic<bool> is_active_ = true;
 };
 
 }  // namespace LNCR
\ No newline at end of file
@@ -1,11 +1,16 @@
 #include "clauncher-client.hpp"
 
 #include <list>
+#include <thread>
 
 #include "clauncher-client-impl.hpp"
+#include "clauncher-trace.hpp"
 
 namespace LNCR {
 
+const std::chrono::milliseconds kCacheResubscribeWait =
+    std::chrono::milliseconds(100);
+
 std::string Unite(const std::list<std::string>& list, char delimiter) {
   std::string result;
   for (const auto& member : list) {
@@ -17,39 +22,65 @@ std::string Unite(const std::list<std::string>& list, char delimiter) {
   return result;
 }
 
-LauncherClient::LauncherClient(int port, LNCR::logging_foo logging_f) {
+LauncherClient::LauncherClient(int port, LNCR::logging_foo logging_f,
+                               bool use_cache) {
   LClient l_client(LClient::Constructor, logging_f);
   Logger& logger = l_client;
-  logger.Log("Creating client", Info);
+  logger.Log(Info, "Creating client");
 
-  logger.Log("Trying to create tcp-client", Debug);
+  logger.Log(Debug, "Trying to create tcp-client");
   implementation_ = std::unique_ptr<Implementation>(new Implementation{
       .port_ = port,
       .logger_ = logging_f,
       .tcp_client_ = new TCP::TcpClient("127.0.0.1", port, logging_f)});
-  logger.Log("Tcp-client created", Debug);
+  logger.Log(Debug, "Tcp-client created");
 
-  logger.Log("Trying to send configuration to server", Debug);
+  logger.Log(Debug, "Trying to send configuration to server");
   implementation_->tcp_client_->Send(static_cast<int>(SenderStatus::Client));
-  logger.Log("Configuration successfully sent. Client created", Debug);
+  logger.Log(Debug, "Configuration successfully sent. Client created");
+
+  if (use_cache) {
+    logger.Log(Debug, "Trying to run status cache updater");
+    implementation_->cache_updater_ =
+        std::thread(&Implementation::CacheUpdater, implementation_.get());
+    logger.Log(Debug, "Status cache updater is running");
+  }
 
-  logger.Log("Client created", Info);
+  logger.Log(Info, "Client created");
 }
 
-LauncherClient::~LauncherClient() {}
+LauncherClient::~LauncherClient() {
+  LClient l_client(LClient::Destructor, implementation_->logger_);
+  Logger& logger = l_client;
+  logger.Log(Info, "Deleting client");
+
+  implementation_->is_active_ = false;
+  if (implementation_->cache_updater_.has_value()) {
+    logger.Log(Debug, "Joining status cache updater");
+    implementation_->cache_updater_->join();
+    logger.Log(Debug, "Status cache updater joined");
+  }
+  delete implementation_->tcp_client_;
+  logger.Log(Info, "Client deleted");
+}
 
 bool LauncherClient::LoadProcess(const std::string& bin_name,
                                  const LNCR::ProcessConfig& process_config,
-                                 bool wait_for_run) {
+                                 bool wait_for_run, const Deadline& deadline) {
   LClient l_client(LClient::LoadProcess, implementation_->logger_);
   Logger& logger = l_client;
 
-  logger.Log("Trying to load process: " + bin_name, Info);
-  logger.Log("Checking tcp-connection", Debug);
+  logger.Log(Info, "Trying to load process: {}", bin_name);
+  int64_t timeout = implementation_->DeadlineToTimeout(deadline);
+  uint64_t trace_id = NewTraceId();
+  logger.Log(Debug, "Trace id: {}", trace_id);
+  logger.Log(Debug, "Checking tcp-connection");
   implementation_->CheckTcpClient();
 
   try {
-    logger.Log("Trying to send command to server", Debug);
+    // the subscription may report the change after this call returns
+    implementation_->InvalidateCache(bin_name);
+    logger.Log(Debug, "Trying to send command to server");
     implementation_->tcp_client_->Send(static_cast<int>(Command::Load));
     implementation_->tcp_client_->Send(
         bin_name, process_config.args.size(), process_config.launch_on_boot,
@@ -57,21 +88,22 @@ bool LauncherClient::LoadProcess(const std::string& bin_name,
         process_config.time_to_stop.has_value()
             ? process_config.time_to_stop.value().count()
             : 0,
-        wait_for_run);
+        wait_for_run, timeout, trace_id,
+        ToTraceTime(std::chrono::system_clock::now()));
     for (const auto& arg : process_config.args) {
       implementation_->tcp_client_->Send(arg);
     }
-    logger.Log("Command send to server", Debug);
+    implementation_->SendLaunchOptions(process_config);
+    logger.Log(Debug, "Command send to server");
 
-    logger.Log("Trying to receive answer from server", Debug);
-    bool result;
-    while (!implementation_->tcp_client_->Receive(
-        implementation_->tcp_client_->GetMsPingThreshold(), result)) {
-    }
-    logger.Log("Answer from server received: " + std::to_string(result), Info);
-    return result;
+    logger.Log(Debug, "Trying to receive answer from server");
+    int result;
+    implementation_->ReceiveAnswer(deadline, logger, result);
+    implementation_->InvalidateCache(bin_name);  // answers got meanwhile
+    logger.Log(Info, "Answer from server received: {}", result);
+    return ToRunResult(result);
   } catch (TCP::TcpException& exception) {
-    logger.Log(std::string("Caught exception: ") + exception.what(), Warning);
+    logger.Log(Warning, "Caught exception: {}", exception.what());
     if (exception.GetType() == TCP::TcpException::ConnectionBreak) {
       delete implementation_->tcp_client_;
       implementation_->tcp_client_ = nullptr;
@@ -81,29 +113,32 @@ bool LauncherClient::LoadProcess(const std::string& bin_name,
 }
 
 TermStatus LauncherClient::StopProcess(const std::string& bin_name,
-                                       bool wait_for_stop) {
+                                       bool wait_for_stop,
+                                       const Deadline& deadline) {
   LClient l_client(LClient::StopProcess, implementation_->logger_);
   Logger& logger = l_client;
-  logger.Log("Trying to stop process: " + bin_name, Info);
+  logger.Log(Info, "Trying to stop process: {}", bin_name);
+  int64_t timeout = implementation_->DeadlineToTimeout(deadline);
 
-  logger.Log("Checking tcp-connection", Debug);
+  logger.Log(Debug, "Checking tcp-connection");
   implementation_->CheckTcpClient();
 
   try {
-    logger.Log("Trying to send command to server", Debug);
+    // the subscription may report the change after this call returns
+    implementation_->InvalidateCache(bin_name);
+    logger.Log(Debug, "Trying to send command to server");
     implementation_->tcp_client_->Send(static_cast<int>(Command::Stop));
-    implementation_->tcp_client_->Send(bin_name, wait_for_stop);
-    logger.Log("Command sent to server", Debug);
+    implementation_->tcp_client_->Send(bin_name, wait_for_stop, timeout);
+    logger.Log(Debug, "Command sent to server");
 
-    logger.Log("Trying to receive answer from server", Debug);
+    logger.Log(Debug, "Trying to receive answer from server");
     int result;
-    while (!implementation_->tcp_client_->Receive(
-        implementation_->tcp_client_->GetMsPingThreshold(), result)) {
-    }
-    logger.Log("Answer from server received: " + std::to_string(result), Info);
+    implementation_->ReceiveAnswer(deadline, logger, result);
+    implementation_->InvalidateCache(bin_name);  // answers got meanwhile
+    logger.Log(Info, "Answer from server received: {}", result);
     return static_cast<TermStatus>(result);
   } catch (TCP::TcpException& exception) {
-    logger.Log(std::string("Caught exception: ") + exception.what(), Warning);
+    logger.Log(Warning, "Caught exception: {}", exception.what());
     if (exception.GetType() == TCP::TcpException::ConnectionBreak) {
       delete implementation_->tcp_client_;
       implementation_->tcp_client_ = nullptr;
@@ -113,29 +148,32 @@ TermStatus LauncherClient::StopProcess(const std::string& bin_name,
 }
 
 bool LauncherClient::ReRunProcess(const std::string& bin_name,
-                                  bool wait_for_rerun) {
+                                  bool wait_for_rerun,
+                                  const Deadline& deadline) {
   LClient l_client(LClient::ReRunProcess, implementation_->logger_);
   Logger& logger = l_client;
-  logger.Log("Trying to rerun process: " + bin_name, Info);
+  logger.Log(Info, "Trying to rerun process: {}", bin_name);
+  int64_t timeout = implementation_->DeadlineToTimeout(deadline);
 
-  logger.Log("Checking tcp-connection", Debug);
+  logger.Log(Debug, "Checking tcp-connection");
   implementation_->CheckTcpClient();
 
   try {
-    logger.Log("Trying to send command to server", Debug);
+    // the subscription may report the change after this call returns
+    implementation_->InvalidateCache(bin_name);
+    logger.Log(Debug, "Trying to send command to server");
     implementation_->tcp_client_->Send(static_cast<int>(Command::Rerun));
-    implementation_->tcp_client_->Send(bin_name, wait_for_rerun);
-    logger.Log("Command send to server", Debug);
+    implementation_->tcp_client_->Send(bin_name, wait_for_rerun, timeout);
+    logger.Log(Debug, "Command send to server");
 
-    logger.Log("Trying to receive answer from server", Debug);
-    bool result;
-    while (!implementation_->tcp_client_->Receive(
-        implementation_->tcp_client_->GetMsPingThreshold(), result)) {
-    }
-    logger.Log("Answer from server received: " + std::to_string(result), Info);
-    return result;
+    logger.Log(Debug, "Trying to receive answer from server");
+    int result;
+    implementation_->ReceiveAnswer(deadline, logger, result);
+    implementation_->InvalidateCache(bin_name);  // answers got meanwhile
+    logger.Log(Info, "Answer from server received: {}", result);
+    return ToRunResult(result);
   } catch (TCP::TcpException& exception) {
-    logger.Log(std::string("Caught exception: ") + exception.what(), Warning);
+    logger.Log(Warning, "Caught exception: {}", exception.what());
     if (exception.GetType() == TCP::TcpException::ConnectionBreak) {
       delete implementation_->tcp_client_;
       implementation_->tcp_client_ = nullptr;
@@ -144,29 +182,47 @@ bool LauncherClient::ReRunProcess(const std::string& bin_name,
   }
 }
 
-bool LauncherClient::IsProcessRunning(const std::string& bin_name) {
+bool LauncherClient::IsProcessRunning(const std::string& bin_name,
+                                      const Deadline& deadline) {
   LClient l_client(LClient::IsProcessRunning, implementation_->logger_);
   Logger& logger = l_client;
-  logger.Log("Trying to check if process is running: " + bin_name, Info);
+  logger.Log(Info, "Trying to check if process is running: {}", bin_name);
+
+  implementation_->cache_m_.lock();
+  auto& cache = implementation_->cache_;
+  uint64_t generation = cache.generation;
+  if (cache.is_valid && cache.running.contains(bin_name)) {
+    bool result = cache.running[bin_name];
+    implementation_->cache_m_.unlock();
+    logger.Log(Info, "Answer got from cache: {}", result);
+    return result;
+  }
+  implementation_->cache_m_.unlock();
+  implementation_->DeadlineToTimeout(deadline);
 
-  logger.Log("Checking tcp-connection", Debug);
+  logger.Log(Debug, "Checking tcp-connection");
   implementation_->CheckTcpClient();
 
   try {
-    logger.Log("Trying to send command to server", Debug);
+    logger.Log(Debug, "Trying to send command to server");
     implementation_->tcp_client_->Send(static_cast<int>(Command::IsRunning));
     implementation_->tcp_client_->Send(bin_name);
-    logger.Log("Command send to server", Debug);
+    logger.Log(Debug, "Command send to server");
 
-    logger.Log("Trying to receive answer from server", Debug);
+    logger.Log(Debug, "Trying to receive answer from server");
     bool result;
-    while (!implementation_->tcp_client_->Receive(
-        implementation_->tcp_client_->GetMsPingThreshold(), result)) {
+    implementation_->ReceiveAnswer(deadline, logger, result);
+    logger.Log(Info, "Answer from server received: {}", result);
+
+    implementation_->cache_m_.lock();
+    if (cache.is_valid && cache.generation == generation) {
+      logger.Log(Debug, "Caching answer");
+      cache.running[bin_name] = result;
     }
-    logger.Log("Answer from server received: " + std::to_string(result), Info);
+    implementation_->cache_m_.unlock();
     return result;
   } catch (TCP::TcpException& exception) {
-    logger.Log(std::string("Caught exception: ") + exception.what(), Warning);
+    logger.Log(Warning, "Caught exception: {}", exception.what());
     if (exception.GetType() == TCP::TcpException::ConnectionBreak) {
       delete implementation_->tcp_client_;
       implementation_->tcp_client_ = nullptr;
@@ -175,32 +231,169 @@ bool LauncherClient::IsProcessRunning(const std::string& bin_name) {
   }
 }
 
-std::optional<int> LauncherClient::GetProcessPid(const std::string& bin_name) {
+std::optional<int> LauncherClient::GetProcessPid(const std::string& bin_name,
+                                                 const Deadline& deadline) {
   LClient l_client(LClient::GetProcessPid, implementation_->logger_);
   Logger& logger = l_client;
-  logger.Log("Trying to get process pid: " + bin_name, Info);
+  logger.Log(Info, "Trying to get process pid: {}", bin_name);
 
-  logger.Log("Checking tcp-connection", Debug);
+  implementation_->cache_m_.lock();
+  auto& cache = implementation_->cache_;
+  uint64_t generation = cache.generation;
+  if (cache.is_valid && cache.pids.contains(bin_name)) {
+    auto result = cache.pids[bin_name];
+    implementation_->cache_m_.unlock();
+    logger.Log(Info, "Answer got from cache");
+    return result;
+  }
+  implementation_->cache_m_.unlock();
+  implementation_->DeadlineToTimeout(deadline);
+
+  logger.Log(Debug, "Checking tcp-connection");
   implementation_->CheckTcpClient();
 
   try {
-    logger.Log("Trying to send command to server", Debug);
+    logger.Log(Debug, "Trying to send command to server");
     implementation_->tcp_client_->Send(static_cast<int>(Command::GetPid));
     implementation_->tcp_client_->Send(bin_name);
-    logger.Log("Command send to server", Debug);
+    logger.Log(Debug, "Command send to server");
 
-    logger.Log("Trying to receive answer from server", Debug);
+    logger.Log(Debug, "Trying to receive answer from server");
     int result;
-    while (!implementation_->tcp_client_->Receive(
-        implementation_->tcp_client_->GetMsPingThreshold(), result)) {
+    implementation_->ReceiveAnswer(deadline, logger, result);
+    logger.Log(Info, "Answer from server received: {}", result);
+    std::optional<int> pid;
+    if (result != 0) {
+      pid = result;
     }
-    logger.Log("Answer from server received: " + std::to_string(result), Info);
-    if (result == 0) {
-      return {};
+
+    implementation_->cache_m_.lock();
+    if (cache.is_valid && cache.generation == generation) {
+      logger.Log(Debug, "Caching answer");
+      cache.pids[bin_name] = pid;
+    }
+    implementation_->cache_m_.unlock();
+    return pid;
+  } catch (TCP::TcpException& exception) {
+    logger.Log(Warning, "Caught exception: {}", exception.what());
+    if (exception.GetType() == TCP::TcpException::ConnectionBreak) {
+      delete implementation_->tcp_client_;
+      implementation_->tcp_client_ = nullptr;
     }
+    throw exception;
+  }
+}
+bool LauncherClient::CancelWaits(const std::string& bin_name,
+                                 const Deadline& deadline) {
+  LClient l_client(LClient::CancelWaits, implementation_->logger_);
+  Logger& logger = l_client;
+  logger.Log(Info, "Trying to cancel waiters of process: {}", bin_name);
+  implementation_->DeadlineToTimeout(deadline);
+
+  logger.Log(Debug, "Checking tcp-connection");
+  implementation_->CheckTcpClient();
+
+  try {
+    logger.Log(Debug, "Trying to send command to server");
+    implementation_->tcp_client_->Send(static_cast<int>(Command::Cancel));
+    implementation_->tcp_client_->Send(bin_name);
+    logger.Log(Debug, "Command send to server");
+
+    logger.Log(Debug, "Trying to receive answer from server");
+    bool result;
+    implementation_->ReceiveAnswer(deadline, logger, result);
+    logger.Log(Info, "Answer from server received: {}", result);
     return result;
   } catch (TCP::TcpException& exception) {
-    logger.Log(std::string("Caught exception: ") + exception.what(), Warning);
+    logger.Log(Warning, "Caught exception: {}", exception.what());
+    if (exception.GetType() == TCP::TcpException::ConnectionBreak) {
+      delete implementation_->tcp_client_;
+      implementation_->tcp_client_ = nullptr;
+    }
+    throw exception;
+  }
+}
+
+ServerStats LauncherClient::GetStats(const Deadline& deadline) {
+  LClient l_client(LClient::GetStats, implementation_->logger_);
+  Logger& logger = l_client;
+  logger.Log(Info, "Trying to get server stats");
+  implementation_->DeadlineToTimeout(deadline);
+
+  logger.Log(Debug, "Checking tcp-connection");
+  implementation_->CheckTcpClient();
+
+  try {
+    logger.Log(Debug, "Trying to send command to server");
+    implementation_->tcp_client_->Send(static_cast<int>(Command::GetStats));
+    logger.Log(Debug, "Command send to server");
+
+    logger.Log(Debug, "Trying to receive answer from server");
+    ServerStats stats;
+    int64_t uptime;
+    implementation_->ReceiveAnswer(
+        deadline, logger, uptime, stats.load_config, stats.running,
+        stats.to_run, stats.to_terminate, stats.clients, stats.subscribers,
+        stats.launches, stats.restarts, stats.watchdog_timeouts,
+        stats.idle_stops, stats.throttled_launches);
+    stats.uptime = std::chrono::milliseconds(uptime);
+    if (uptime != 0) {
+      stats.launches_per_second =
+          stats.launches * 1000.0 / static_cast<double>(uptime);
+    }
+    stats.spawn_latency = implementation_->ReceiveLatency(deadline, logger);
+    stats.stop_latency = implementation_->ReceiveLatency(deadline, logger);
+    stats.control_loop = implementation_->ReceiveLatency(deadline, logger);
+
+    uint64_t size;
+    implementation_->ReceiveAnswer(deadline, logger, size);
+    for (uint64_t i = 0; i < size; ++i) {
+      MutexStats mutex;
+      implementation_->ReceiveAnswer(deadline, logger, mutex.name,
+                                     mutex.acquisitions, mutex.contended);
+      stats.mutexes.push_back(std::move(mutex));
+    }
+    implementation_->ReceiveAnswer(deadline, logger, size);
+    for (uint64_t i = 0; i < size; ++i) {
+      ActionStats action;
+      implementation_->ReceiveAnswer(deadline, logger, action.module,
+                                     action.action, action.calls);
+      action.latency = implementation_->ReceiveLatency(deadline, logger);
+      stats.actions.push_back(std::move(action));
+    }
+    logger.Log(Info, "Stats received: {} actions", stats.actions.size());
+    return stats;
+  } catch (TCP::TcpException& exception) {
+    logger.Log(Warning, "Caught exception: {}", exception.what());
+    if (exception.GetType() == TCP::TcpException::ConnectionBreak) {
+      delete implementation_->tcp_client_;
+      implementation_->tcp_client_ = nullptr;
+    }
+    throw exception;
+  }
+}
+
+std::string LauncherClient::GetTrace(const Deadline& deadline) {
+  LClient l_client(LClient::GetTrace, implementation_->logger_);
+  Logger& logger = l_client;
+  logger.Log(Info, "Trying to get launch trace");
+  implementation_->DeadlineToTimeout(deadline);
+
+  logger.Log(Debug, "Checking tcp-connection");
+  implementation_->CheckTcpClient();
+
+  try {
+    logger.Log(Debug, "Trying to send command to server");
+    implementation_->tcp_client_->Send(static_cast<int>(Command::GetTrace));
+    logger.Log(Debug, "Command send to server");
+
+    logger.Log(Debug, "Trying to receive answer from server");
+    std::string trace;
+    implementation_->ReceiveAnswer(deadline, logger, trace);
+    logger.Log(Info, "Trace received: {} bytes", trace.size());
+    return trace;
+  } catch (TCP::TcpException& exception) {
+    logger.Log(Warning, "Caught exception: {}", exception.what());
     if (exception.GetType() == TCP::TcpException::ConnectionBreak) {
       delete implementation_->tcp_client_;
       implementation_->tcp_client_ = nullptr;
@@ -208,23 +401,284 @@ std::optional<int> LauncherClient::GetProcessPid(const std::string& bin_name) {
     throw exception;
   }
 }
+
+std::map<std::string, ApplyResult> LauncherClient::ReloadConfig(
+    const Deadline& deadline) {
+  LClient l_client(LClient::ReloadConfig, implementation_->logger_);
+  Logger& logger = l_client;
+  logger.Log(Info, "Trying to reload server config");
+  implementation_->DeadlineToTimeout(deadline);
+
+  logger.Log(Debug, "Checking tcp-connection");
+  implementation_->CheckTcpClient();
+
+  try {
+    // the subscription may report the change after this call returns
+    implementation_->InvalidateCache();
+    logger.Log(Debug, "Trying to send command to server");
+    implementation_->tcp_client_->Send(static_cast<int>(Command::Reload));
+    logger.Log(Debug, "Command send to server");
+
+    logger.Log(Debug, "Trying to receive answer from server");
+    auto results = implementation_->ReceiveApplyResults(deadline, logger);
+    implementation_->InvalidateCache();  // answers got meanwhile
+    logger.Log(Info, "Config reloaded: {} processes", results.size());
+    return results;
+  } catch (TCP::TcpException& exception) {
+    logger.Log(Warning, "Caught exception: {}", exception.what());
+    if (exception.GetType() == TCP::TcpException::ConnectionBreak) {
+      delete implementation_->tcp_client_;
+      implementation_->tcp_client_ = nullptr;
+    }
+    throw exception;
+  }
+}
+
+std::map<std::string, ApplyResult> LauncherClient::ApplyDesiredState(
+    const std::map<std::string, ProcessConfig>& desired, size_t max_parallel,
+    const Deadline& deadline) {
+  LClient l_client(LClient::ApplyDesiredState, implementation_->logger_);
+  Logger& logger = l_client;
+  logger.Log(Info, "Trying to apply desired state: {} processes",
+             desired.size());
+  int64_t timeout = implementation_->DeadlineToTimeout(deadline);
+
+  logger.Log(Debug, "Checking tcp-connection");
+  implementation_->CheckTcpClient();
+
+  try {
+    // the subscription may report the change after this call returns
+    implementation_->InvalidateCache();
+    logger.Log(Debug, "Trying to send command to server");
+    implementation_->tcp_client_->Send(static_cast<int>(Command::ApplyState));
+    implementation_->tcp_client_->Send(static_cast<uint64_t>(desired.size()),
+                                       static_cast<uint64_t>(max_parallel),
+                                       timeout);
+    for (const auto& [bin_name, config] : desired) {
+      implementation_->tcp_client_->Send(
+          bin_name, static_cast<int>(config.args.size()),
+          config.launch_on_boot, config.term_rerun,
+          config.time_to_stop.has_value()
+              ? static_cast<int>(config.time_to_stop.value().count())
+              : 0);
+      for (const auto& arg : config.args) {
+        implementation_->tcp_client_->Send(arg);
+      }
+      implementation_->SendLaunchOptions(config);
+    }
+    logger.Log(Debug, "Command send to server");
+
+    logger.Log(Debug, "Trying to receive answer from server");
+    auto results = implementation_->ReceiveApplyResults(deadline, logger);
+    implementation_->InvalidateCache();  // answers got meanwhile
+    logger.Log(Info, "Desired state applied: {} processes", results.size());
+    return results;
+  } catch (TCP::TcpException& exception) {
+    logger.Log(Warning, "Caught exception: {}", exception.what());
+    if (exception.GetType() == TCP::TcpException::ConnectionBreak) {
+      delete implementation_->tcp_client_;
+      implementation_->tcp_client_ = nullptr;
+    }
+    throw exception;
+  }
+}
+
+void LauncherClient::Subscribe(
+    const std::function<bool(const ProcessEvent&)>& handler) {
+  implementation_->Subscribe(handler);
+}
+
+int64_t LauncherClient::Implementation::DeadlineToTimeout(
+    const Deadline& deadline) const {
+  if (!deadline.has_value()) {
+    return 0;
+  }
+  auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+      deadline.value() - std::chrono::system_clock::now());
+  if (left.count() <= 0) {
+    throw LauncherException(LauncherException::DeadlineExceeded);
+  }
+  return left.count();
+}
+
+void LauncherClient::Implementation::SendLaunchOptions(
+    const ProcessConfig& config) {
+  tcp_client_->Send(config.rolling_restart, config.on_demand,
+                    static_cast<int>(config.listen_ports.size()));
+  for (uint16_t port : config.listen_ports) {
+    tcp_client_->Send(static_cast<int>(port));
+  }
+  tcp_client_->Send(config.ready_timeout.has_value()
+                        ? config.ready_timeout.value().count()
+                        : static_cast<int64_t>(0));
+  tcp_client_->Send(config.watchdog_interval.has_value()
+                        ? config.watchdog_interval.value().count()
+                        : static_cast<int64_t>(0));
+  tcp_client_->Send(config.idle_timeout.has_value()
+                        ? config.idle_timeout.value().count()
+                        : static_cast<int64_t>(0));
+  tcp_client_->Send(config.priority,
+                    config.launch_limit.has_value()
+                        ? static_cast<int>(config.launch_limit.value().burst)
+                        : 0,
+                    config.launch_limit.has_value()
+                        ? config.launch_limit.value().interval.count()
+                        : static_cast<int64_t>(0));
+}
+
+std::map<std::string, ApplyResult>
+LauncherClient::Implementation::ReceiveApplyResults(const Deadline& deadline,
+                                                    Logger& logger) {
+  uint64_t results_num;
+  ReceiveAnswer(deadline, logger, results_num);
+  std::map<std::string, ApplyResult> results;
+  for (uint64_t i = 0; i < results_num; ++i) {
+    std::string bin_name;
+    int action;
+    bool is_succeeded;
+    ReceiveAnswer(deadline, logger, bin_name, action, is_succeeded);
+    results.insert({std::move(bin_name),
+                    {static_cast<ApplyAction>(action), is_succeeded}});
+  }
+  return results;
+}
+
+LatencyStats LauncherClient::Implementation::ReceiveLatency(
+    const Deadline& deadline, Logger& logger) {
+  LatencyStats stats;
+  int64_t mean, p50, p90, p99, p999, max;
+  ReceiveAnswer(deadline, logger, stats.count, mean, p50, p90, p99, p999,
+                max);
+  stats.mean = std::chrono::nanoseconds(mean);
+  stats.p50 = std::chrono::nanoseconds(p50);
+  stats.p90 = std::chrono::nanoseconds(p90);
+  stats.p99 = std::chrono::nanoseconds(p99);
+  stats.p999 = std::chrono::nanoseconds(p999);
+  stats.max = std::chrono::nanoseconds(max);
+  return stats;
+}
 void LauncherClient::Implementation::CheckTcpClient() {
   LClient l_client(LClient::CheckTcpClient, logger_);
   Logger& logger = l_client;
-  logger.Log("Trying to check tcp-connection", Debug);
+  logger.Log(Debug, "Trying to check tcp-connection");
 
   if (tcp_client_ == nullptr) {
     try {
-      logger.Log("Tcp-connection is not active. Trying to connect", Debug);
+      logger.Log(Debug, "Tcp-connection is not active. Trying to connect");
       tcp_client_ = new TCP::TcpClient("127.0.0.1", port_, logger_);
     } catch (TCP::TcpException& tcp_exception) {
-      logger.Log(std::string("Tcp-connection cannot be established: ") +
-                     tcp_exception.what(),
-                 Warning);
+      logger.Log(Warning, "Tcp-connection cannot be established: {}",
+                 tcp_exception.what());
       throw tcp_exception;
     }
   }
-  logger.Log("Tcp-connection is active", Debug);
+  logger.Log(Debug, "Tcp-connection is active");
+}
+
+void LauncherClient::Implementation::Subscribe(
+    const std::function<bool(const ProcessEvent&)>& handler,
+    const std::function<void()>& on_subscribed,
+    const std::atomic<bool>* is_active) {
+  LClient l_client(LClient::Subscribe, logger_);
+  Logger& logger = l_client;
+  logger.Log(Info, "Trying to subscribe to process events");
+
+  logger.Log(Debug, "Trying to create dedicated tcp-client");
+  TCP::TcpClient tcp_client("127.0.0.1", port_, logger_);
+  logger.Log(Debug, "Tcp-client created");
+
+  try {
+    logger.Log(Debug, "Trying to send command to server");
+    tcp_client.Send(static_cast<int>(SenderStatus::Client));
+    tcp_client.Send(static_cast<int>(Command::Subscribe));
+    logger.Log(Debug, "Command sent to server");
+
+    logger.Log(Debug, "Trying to receive subscription confirmation");
+    bool result;
+    while (!tcp_client.Receive(tcp_client.GetMsPingThreshold(), result)) {
+    }
+    logger.Log(Info, "Subscribed. Receiving events");
+    if (on_subscribed) {
+      on_subscribed();
+    }
+
+    while (is_active == nullptr || *is_active) {
+      int type;
+      ProcessEvent event;
+      if (!tcp_client.Receive(tcp_client.GetMsPingThreshold(), type,
+                              event.bin_name, event.value)) {
+        continue;
+      }
+      event.type = static_cast<ProcessEventType>(type);
+      logger.Log(Debug, "Event received: {} {} {}", type, event.bin_name,
+                 event.value);
+      if (!handler(event)) {
+        logger.Log(Info, "Handler finished subscription");
+        return;
+      }
+    }
+  } catch (TCP::TcpException& exception) {
+    logger.Log(Warning, "Caught exception: {}", exception.what());
+    throw exception;
+  }
+}
+
+void LauncherClient::Implementation::InvalidateCache(
+    const std::string& bin_name) noexcept {
+  cache_m_.lock();
+  ++cache_.generation;  // answers being received are not cached
+  if (bin_name.empty()) {
+    cache_.pids.clear();
+    cache_.running.clear();
+  } else {
+    cache_.pids.erase(bin_name);
+    cache_.running.erase(bin_name);
+  }
+  cache_m_.unlock();
+}
+void LauncherClient::Implementation::CacheUpdater() noexcept {
+  LClient l_client(LClient::CacheUpdater, logger_);
+  Logger& logger = l_client;
+  logger.Log(Info, "Entering loop");
+
+  auto invalidate = [this, &logger](const ProcessEvent& event) {
+    if (event.type == QueueOverflow) {
+      logger.Log(Warning, "Events were lost, clearing cache");
+      InvalidateCache();
+    } else {
+      logger.Log(Debug, "Invalidating {}", event.bin_name);
+      InvalidateCache(event.bin_name);
+    }
+    return is_active_.load();
+  };
+  auto validate = [this, &logger]() {
+    cache_m_.lock();
+    ++cache_.generation;
+    cache_.is_valid = true;
+    cache_m_.unlock();
+    logger.Log(Info, "Cache is valid");
+  };
+
+  while (is_active_) {
+    try {
+      Subscribe(invalidate, validate, &is_active_);
+    } catch (std::exception& exception) {
+      logger.Log(Warning, "Subscription failed: {}", exception.what());
+    }
+
+    cache_m_.lock();
+    ++cache_.generation;
+    cache_.is_valid = false;
+    cache_.pids.clear();
+    cache_.running.clear();
+    cache_m_.unlock();
+    logger.Log(Info, "Cache is disabled until resubscribed");
+
+    if (is_active_) {
+      std::this_thread::sleep_for(kCacheResubscribeWait);
+    }
+  }
+  logger.Log(Info, "Exiting loop");
 }
 
 }  // namespace LNCR
\ No newline at end of file
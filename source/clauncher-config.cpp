@@ -0,0 +1,516 @@
+#include "clauncher-config.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <array>
+#include <cstring>
+#include <sstream>
+
+namespace LNCR {
+
+// All integers are in the native byte order. Fields are only appended to
+// the fixed structs; readers use the written struct sizes to skip unknown
+// fields, and zero-fill the fields missing in older files.
+const char kConfigMagic[8] = {'L', 'N', 'C', 'R', 'C', 'F', 'G', '\0'};
+
+struct ConfigHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t header_size;
+  uint64_t entries;
+  uint64_t payload_size;
+  uint32_t checksum;  // CRC-32 of the payload
+  uint32_t reserved;
+};
+// entry: [EntryHeader][name][args: [uint32_t size][arg]...][ports]
+//        [padding to 8]
+struct EntryHeader {
+  uint32_t entry_size;
+  uint32_t fixed_size;
+  uint32_t name_size;
+  uint32_t args_num;
+  int64_t time_to_stop;  // ms, -1 if not set
+  uint8_t term_rerun;
+  uint8_t rolling_restart;
+  uint8_t on_demand;
+  uint8_t reserved[5];
+  uint32_t ports_num;  // [uint16_t port]... follow args
+  uint32_t reserved_2;
+  int64_t ready_timeout;      // ms, -1 if not set
+  int64_t watchdog_interval;  // ms, -1 if not set
+  int64_t idle_timeout;       // ms, -1 if not set
+  int32_t priority;
+  uint32_t launch_burst;  // 0 if launch limit is not set
+  int64_t launch_interval;  // ms
+};
+// journal record: [RecordHeader][type][entry or name of binary]
+struct RecordHeader {
+  uint32_t size;
+  uint32_t checksum;  // CRC-32 of the record payload
+};
+const char kRecordSet = '+';
+const char kRecordErase = '-';
+
+// handover file: [ConfigHeader][entries: [HandoverHeader][entry]...]
+const char kHandoverMagic[8] = {'L', 'N', 'C', 'R', 'H', 'N', 'D', '\0'};
+const uint32_t kHandoverVersion = 1;
+
+struct HandoverHeader {
+  uint32_t fixed_size;
+  int32_t pid;
+  uint64_t start_time;
+  uint8_t launch_on_boot;
+  uint8_t reserved[7];
+};
+
+const size_t kEntryAlign = 8;
+
+/*--------------------------- secondary functions ----------------------------*/
+uint32_t Crc32(std::string_view data) {
+  static const auto table = [] {
+    std::array<uint32_t, 256> table;
+    for (uint32_t i = 0; i < 256; ++i) {
+      uint32_t crc = i;
+      for (int bit = 0; bit < 8; ++bit) {
+        crc = (crc & 1) != 0 ? (crc >> 1) ^ 0xEDB88320u : crc >> 1;
+      }
+      table[i] = crc;
+    }
+    return table;
+  }();
+
+  uint32_t crc = 0xFFFFFFFFu;
+  for (unsigned char symbol : data) {
+    crc = table[(crc ^ symbol) & 0xFF] ^ (crc >> 8);
+  }
+  return crc ^ 0xFFFFFFFFu;
+}
+
+template <typename T>
+void AppendRaw(std::string& data, const T& value) {
+  data.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+// copies known part of the struct written with size bytes
+template <typename T>
+T ReadRaw(std::string_view data, size_t size) {
+  T value;
+  std::memset(&value, 0, sizeof(value));
+  std::memcpy(&value, data.data(), std::min(size, sizeof(value)));
+  return value;
+}
+
+void AppendEntry(std::string& data, const std::string& bin_name,
+                 const ProcessConfig& config) {
+  size_t begin = data.size();
+  EntryHeader header = {};
+  header.fixed_size = sizeof(EntryHeader);
+  header.name_size = bin_name.size();
+  header.args_num = config.args.size();
+  header.time_to_stop = config.time_to_stop.has_value()
+                            ? config.time_to_stop.value().count()
+                            : -1;
+  header.term_rerun = config.term_rerun;
+  header.rolling_restart = config.rolling_restart;
+  header.on_demand = config.on_demand;
+  header.ports_num = config.listen_ports.size();
+  header.ready_timeout = config.ready_timeout.has_value()
+                             ? config.ready_timeout.value().count()
+                             : -1;
+  header.watchdog_interval = config.watchdog_interval.has_value()
+                                 ? config.watchdog_interval.value().count()
+                                 : -1;
+  header.idle_timeout = config.idle_timeout.has_value()
+                            ? config.idle_timeout.value().count()
+                            : -1;
+  header.priority = config.priority;
+  if (config.launch_limit.has_value()) {
+    header.launch_burst = config.launch_limit.value().burst;
+    header.launch_interval = config.launch_limit.value().interval.count();
+  }
+  AppendRaw(data, header);
+
+  data += bin_name;
+  for (const auto& arg : config.args) {
+    AppendRaw(data, static_cast<uint32_t>(arg.size()));
+    data += arg;
+  }
+  for (uint16_t port : config.listen_ports) {
+    AppendRaw(data, port);
+  }
+  data.resize(begin + (data.size() - begin + kEntryAlign - 1) / kEntryAlign *
+                          kEntryAlign);
+
+  uint32_t entry_size = data.size() - begin;
+  std::memcpy(data.data() + begin, &entry_size, sizeof(entry_size));
+}
+// entry_size is the size of the entry on success
+bool ReadEntry(std::string_view data, std::string& bin_name,
+               ProcessConfig& config, size_t& entry_size) {
+  if (data.size() < 2 * sizeof(uint32_t)) {
+    return false;
+  }
+  auto sizes = ReadRaw<std::array<uint32_t, 2>>(data, 2 * sizeof(uint32_t));
+  entry_size = sizes[0];
+  size_t fixed_size = sizes[1];
+  if (entry_size > data.size() || fixed_size > entry_size ||
+      fixed_size < offsetof(EntryHeader, term_rerun) + 1) {
+    return false;
+  }
+  auto header = ReadRaw<EntryHeader>(data, fixed_size);
+
+  size_t offset = fixed_size;
+  if (header.name_size > entry_size - offset) {
+    return false;
+  }
+  bin_name.assign(data.data() + offset, header.name_size);
+  offset += header.name_size;
+
+  config.args.clear();
+  for (uint32_t i = 0; i < header.args_num; ++i) {
+    if (entry_size - offset < sizeof(uint32_t)) {
+      return false;
+    }
+    uint32_t arg_size;
+    std::memcpy(&arg_size, data.data() + offset, sizeof(arg_size));
+    offset += sizeof(arg_size);
+    if (arg_size > entry_size - offset) {
+      return false;
+    }
+    config.args.emplace_back(data.data() + offset, arg_size);
+    offset += arg_size;
+  }
+  if (header.ports_num > (entry_size - offset) / sizeof(uint16_t)) {
+    return false;
+  }
+  config.listen_ports.resize(header.ports_num);
+  std::memcpy(config.listen_ports.data(), data.data() + offset,
+              header.ports_num * sizeof(uint16_t));
+
+  config.launch_on_boot = true;
+  config.term_rerun = header.term_rerun != 0;
+  config.rolling_restart = header.rolling_restart != 0;
+  config.on_demand = header.on_demand != 0;
+  config.time_to_stop.reset();
+  if (header.time_to_stop >= 0) {
+    config.time_to_stop = std::chrono::milliseconds(header.time_to_stop);
+  }
+  // zero in entries written before the fields
+  config.ready_timeout.reset();
+  if (header.ready_timeout > 0) {
+    config.ready_timeout = std::chrono::milliseconds(header.ready_timeout);
+  }
+  config.watchdog_interval.reset();
+  if (header.watchdog_interval > 0) {
+    config.watchdog_interval =
+        std::chrono::milliseconds(header.watchdog_interval);
+  }
+  config.idle_timeout.reset();
+  if (header.idle_timeout > 0) {
+    config.idle_timeout = std::chrono::milliseconds(header.idle_timeout);
+  }
+  config.priority = header.priority;
+  config.launch_limit.reset();
+  if (header.launch_burst > 0) {
+    config.launch_limit = {
+        .interval = std::chrono::milliseconds(header.launch_interval),
+        .burst = header.launch_burst};
+  }
+  return true;
+}
+
+// read-only private mapping of the whole file
+class MappedFile {
+ public:
+  MappedFile(const std::string& path) {
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+      return;
+    }
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) == 0 && file_stat.st_size > 0) {
+      void* data = mmap(nullptr, file_stat.st_size, PROT_READ, MAP_PRIVATE,
+                        fd, 0);
+      if (data != MAP_FAILED) {
+        data_ = static_cast<const char*>(data);
+        size_ = file_stat.st_size;
+      }
+    }
+    is_opened_ = true;
+    close(fd);
+  }
+  MappedFile(const MappedFile&) = delete;
+  ~MappedFile() {
+    if (data_ != nullptr) {
+      munmap(const_cast<char*>(data_), size_);
+    }
+  }
+
+  bool IsOpened() const { return is_opened_; }
+  std::string_view GetData() const { return {data_, size_}; }
+
+ private:
+  const char* data_ = nullptr;
+  size_t size_ = 0;
+  bool is_opened_ = false;
+};
+
+/*------------------------------- config file --------------------------------*/
+// fills the header reserved at the beginning of data
+void WriteHeader(std::string& data, const char (&magic)[8], uint32_t version,
+                 uint64_t entries) {
+  ConfigHeader header = {};
+  std::memcpy(header.magic, magic, sizeof(header.magic));
+  header.version = version;
+  header.header_size = sizeof(ConfigHeader);
+  header.entries = entries;
+  header.payload_size = data.size() - sizeof(ConfigHeader);
+  header.checksum =
+      Crc32(std::string_view(data).substr(sizeof(ConfigHeader)));
+  std::memcpy(data.data(), &header, sizeof(header));
+}
+// payload is the checksummed data after the header
+bool ReadHeader(std::string_view data, const char (&magic)[8],
+                uint32_t version, ConfigHeader& header,
+                std::string_view& payload) {
+  if (data.size() < offsetof(ConfigHeader, reserved) ||
+      std::memcmp(data.data(), magic, sizeof(magic)) != 0) {
+    return false;
+  }
+  uint32_t header_size;
+  std::memcpy(&header_size, data.data() + offsetof(ConfigHeader, header_size),
+              sizeof(header_size));
+  if (header_size < offsetof(ConfigHeader, reserved) ||
+      header_size > data.size()) {
+    return false;
+  }
+  header = ReadRaw<ConfigHeader>(data, header_size);
+  payload = data.substr(header_size);
+  return header.version <= version &&
+         header.payload_size == payload.size() &&
+         header.checksum == Crc32(payload);
+}
+
+std::string SerializeConfig(const BootConfig& boot_config) {
+  std::string data(sizeof(ConfigHeader), '\0');
+  uint64_t entries = 0;
+  for (const auto& [bin_name, config] : boot_config) {
+    if (!config.launch_on_boot) {
+      continue;
+    }
+    AppendEntry(data, bin_name, config);
+    ++entries;
+  }
+  WriteHeader(data, kConfigMagic, kConfigVersion, entries);
+  return data;
+}
+bool DeserializeConfig(std::string_view data, BootConfig& boot_config) {
+  ConfigHeader header;
+  std::string_view payload;
+  if (!ReadHeader(data, kConfigMagic, kConfigVersion, header, payload)) {
+    return false;
+  }
+
+  BootConfig result;
+  for (uint64_t i = 0; i < header.entries; ++i) {
+    std::string bin_name;
+    ProcessConfig config;
+    size_t entry_size;
+    if (!ReadEntry(payload, bin_name, config, entry_size)) {
+      return false;
+    }
+    result.insert_or_assign(std::move(bin_name), std::move(config));
+    payload.remove_prefix(entry_size);
+  }
+  boot_config = std::move(result);
+  return true;
+}
+
+bool ReadConfigFile(const std::string& path, BootConfig& boot_config) {
+  MappedFile file(path);
+  if (!file.IsOpened()) {
+    return false;
+  }
+  auto data = file.GetData();
+  if (data.size() >= sizeof(kConfigMagic) &&
+      std::memcmp(data.data(), kConfigMagic, sizeof(kConfigMagic)) == 0) {
+    return DeserializeConfig(data, boot_config);
+  }
+  std::istringstream text{std::string(data)};
+  return ImportTextConfig(text, boot_config);
+}
+
+/*-------------------------------- text format -------------------------------*/
+std::string ExportTextConfig(const BootConfig& boot_config) {
+  std::string entries;
+  size_t table_size = 0;
+  for (const auto& [bin_name, config] : boot_config) {
+    if (!config.launch_on_boot) {
+      continue;
+    }
+    entries += bin_name + "\t" + std::to_string(config.args.size()) + "\t";
+    for (const auto& arg : config.args) {
+      entries += arg + "\t";
+    }
+    entries += std::to_string(config.term_rerun) + "\t" +
+               std::to_string(config.time_to_stop.has_value()
+                                  ? config.time_to_stop.value().count()
+                                  : 0) +
+               "\n";
+    ++table_size;
+  }
+  return std::to_string(table_size) + "\n" + entries;
+}
+bool ImportTextConfig(std::istream& stream, BootConfig& boot_config) {
+  int table_size;
+  if (!(stream >> table_size)) {
+    return false;
+  }
+
+  BootConfig result;
+  for (int i = 0; i < table_size; ++i) {
+    std::string bin_name;
+    ProcessConfig config;
+    int arg_num;
+    stream >> bin_name >> arg_num;
+    for (int j = 0; stream && j < arg_num; ++j) {
+      std::string arg;
+      stream >> arg;
+      config.args.push_back(std::move(arg));
+    }
+
+    config.launch_on_boot = true;
+    int delay;
+    stream >> config.term_rerun >> delay;
+    if (!stream) {
+      return false;
+    }
+    if (delay != 0) {
+      config.time_to_stop = std::chrono::milliseconds(delay);
+    }
+    result.insert_or_assign(std::move(bin_name), std::move(config));
+  }
+  boot_config = std::move(result);
+  return true;
+}
+
+/*---------------------------------- journal ---------------------------------*/
+std::string SerializeRecord(std::string&& payload) {
+  RecordHeader header = {.size = static_cast<uint32_t>(payload.size()),
+                         .checksum = Crc32(payload)};
+  std::string record;
+  record.reserve(sizeof(header) + payload.size());
+  AppendRaw(record, header);
+  record += payload;
+  return record;
+}
+std::string SerializeJournalSet(const std::string& bin_name,
+                                const ProcessConfig& config) {
+  std::string payload(1, kRecordSet);
+  AppendEntry(payload, bin_name, config);
+  return SerializeRecord(std::move(payload));
+}
+std::string SerializeJournalErase(const std::string& bin_name) {
+  return SerializeRecord(kRecordErase + bin_name);
+}
+size_t ReplayJournal(std::string_view data, BootConfig& boot_config,
+                     bool& is_torn) {
+  size_t replayed = 0;
+  is_torn = false;
+  while (!data.empty()) {
+    if (data.size() < sizeof(RecordHeader)) {
+      is_torn = true;
+      break;
+    }
+    auto header = ReadRaw<RecordHeader>(data, sizeof(RecordHeader));
+    data.remove_prefix(sizeof(RecordHeader));
+    if (header.size == 0 || header.size > data.size() ||
+        header.checksum != Crc32(data.substr(0, header.size))) {
+      is_torn = true;
+      break;
+    }
+    auto payload = data.substr(1, header.size - 1);
+    if (data[0] == kRecordSet) {
+      std::string bin_name;
+      ProcessConfig config;
+      size_t entry_size;
+      if (!ReadEntry(payload, bin_name, config, entry_size)) {
+        is_torn = true;
+        break;
+      }
+      boot_config.insert_or_assign(std::move(bin_name), std::move(config));
+    } else if (data[0] == kRecordErase) {
+      boot_config.erase(std::string(payload));
+    } else {
+      is_torn = true;
+      break;
+    }
+    data.remove_prefix(header.size);
+    ++replayed;
+  }
+  return replayed;
+}
+size_t ReadJournalFile(const std::string& path, BootConfig& boot_config,
+                       bool& is_torn) {
+  MappedFile file(path);
+  return ReplayJournal(file.GetData(), boot_config, is_torn);
+}
+
+/*--------------------------------- handover ---------------------------------*/
+std::string SerializeHandover(const std::vector<HandoverEntry>& entries) {
+  std::string data(sizeof(ConfigHeader), '\0');
+  for (const auto& entry : entries) {
+    HandoverHeader header = {};
+    header.fixed_size = sizeof(HandoverHeader);
+    header.pid = entry.pid;
+    header.start_time = entry.start_time;
+    header.launch_on_boot = entry.config.launch_on_boot;
+    AppendRaw(data, header);
+    AppendEntry(data, entry.bin_name, entry.config);
+  }
+  WriteHeader(data, kHandoverMagic, kHandoverVersion, entries.size());
+  return data;
+}
+bool DeserializeHandover(std::string_view data,
+                         std::vector<HandoverEntry>& entries) {
+  ConfigHeader header;
+  std::string_view payload;
+  if (!ReadHeader(data, kHandoverMagic, kHandoverVersion, header, payload)) {
+    return false;
+  }
+
+  std::vector<HandoverEntry> result;
+  for (uint64_t i = 0; i < header.entries; ++i) {
+    if (payload.size() < sizeof(uint32_t)) {
+      return false;
+    }
+    auto fixed_size = ReadRaw<uint32_t>(payload, sizeof(uint32_t));
+    if (fixed_size > payload.size() ||
+        fixed_size < offsetof(HandoverHeader, launch_on_boot) + 1) {
+      return false;
+    }
+    auto handover_header = ReadRaw<HandoverHeader>(payload, fixed_size);
+    payload.remove_prefix(fixed_size);
+
+    HandoverEntry entry = {.pid = handover_header.pid,
+                           .start_time = handover_header.start_time};
+    size_t entry_size;
+    if (!ReadEntry(payload, entry.bin_name, entry.config, entry_size)) {
+      return false;
+    }
+    entry.config.launch_on_boot = handover_header.launch_on_boot != 0;
+    result.push_back(std::move(entry));
+    payload.remove_prefix(entry_size);
+  }
+  entries = std::move(result);
+  return true;
+}
+bool ReadHandoverFile(const std::string& path,
+                      std::vector<HandoverEntry>& entries) {
+  MappedFile file(path);
+  return file.IsOpened() && DeserializeHandover(file.GetData(), entries);
+}
+
+}  // namespace LNCR
\ No newline at end of file
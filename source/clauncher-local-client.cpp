@@ -0,0 +1,82 @@
+#include "clauncher-local-client.hpp"
+
+#include "clauncher-server-impl.hpp"
+
+namespace LNCR {
+
+void CheckDeadline(const Deadline& deadline) {
+  if (deadline.has_value() &&
+      deadline.value() <= std::chrono::system_clock::now()) {
+    throw LauncherException(LauncherException::DeadlineExceeded);
+  }
+}
+
+LauncherLocalClient::LauncherLocalClient(LauncherServer& server)
+    : implementation_(server.implementation_.get()) {}
+
+bool LauncherLocalClient::LoadProcess(const std::string& bin_name,
+                                      const ProcessConfig& process_config,
+                                      bool wait_for_run,
+                                      const Deadline& deadline) {
+  CheckDeadline(deadline);
+  auto c_bin_name = bin_name;
+  auto c_process_config = process_config;
+  return ToRunResult(implementation_->RunProcess(
+      std::move(c_bin_name), std::move(c_process_config), wait_for_run,
+      deadline, {.started = std::chrono::system_clock::now()}));
+}
+
+TermStatus LauncherLocalClient::StopProcess(const std::string& bin_name,
+                                            bool wait_for_stop,
+                                            const Deadline& deadline) {
+  CheckDeadline(deadline);
+  return implementation_->StopProcess(bin_name, wait_for_stop, deadline);
+}
+
+bool LauncherLocalClient::ReRunProcess(const std::string& bin_name,
+                                       bool wait_for_rerun,
+                                       const Deadline& deadline) {
+  CheckDeadline(deadline);
+  auto c_bin_name = bin_name;
+  return ToRunResult(implementation_->RerunProcess(
+      std::move(c_bin_name), wait_for_rerun, deadline));
+}
+
+bool LauncherLocalClient::IsProcessRunning(const std::string& bin_name,
+                                           const Deadline& deadline) {
+  CheckDeadline(deadline);
+  return implementation_->IsRunning(bin_name);
+}
+
+std::optional<int> LauncherLocalClient::GetProcessPid(
+    const std::string& bin_name, const Deadline& deadline) {
+  CheckDeadline(deadline);
+  return implementation_->GetPid(bin_name);
+}
+
+bool LauncherLocalClient::CancelWaits(const std::string& bin_name,
+                                      const Deadline& deadline) {
+  CheckDeadline(deadline);
+  return implementation_->CancelWaits(bin_name);
+}
+ServerStats LauncherLocalClient::GetStats(const Deadline& deadline) {
+  CheckDeadline(deadline);
+  return implementation_->GetStats();
+}
+std::string LauncherLocalClient::GetTrace(const Deadline& deadline) {
+  CheckDeadline(deadline);
+  return implementation_->trace_.GetChromeTrace();
+}
+std::map<std::string, ApplyResult> LauncherLocalClient::ReloadConfig(
+    const Deadline& deadline) {
+  CheckDeadline(deadline);
+  return implementation_->ReloadConfig();
+}
+std::map<std::string, ApplyResult> LauncherLocalClient::ApplyDesiredState(
+    const std::map<std::string, ProcessConfig>& desired, size_t max_parallel,
+    const Deadline& deadline) {
+  CheckDeadline(deadline);
+  return implementation_->ApplyDesiredState(desired, max_parallel, deadline);
+}
+
+}  // namespace LNCR
\ No newline at end of file
@@ -0,0 +1,94 @@
+#include "clauncher-metrics.hpp"
+
+#include <algorithm>
+#include <bit>
+
+namespace LNCR {
+
+int LatencyHistogram::GetBucket(uint64_t value) noexcept {
+  if (value < kSubBuckets) {
+    return static_cast<int>(value);
+  }
+  int shift = std::bit_width(value) - 1 - kSubBucketBits;
+  int sub_bucket = static_cast<int>(value >> shift) - kSubBuckets;
+  return (shift + 1) * kSubBuckets + sub_bucket;
+}
+uint64_t LatencyHistogram::GetBucketTop(int bucket) noexcept {
+  if (bucket < kSubBuckets) {
+    return bucket;
+  }
+  int shift = bucket / kSubBuckets - 1;
+  uint64_t sub_bucket = bucket % kSubBuckets;
+  return ((kSubBuckets + sub_bucket) << shift) + ((uint64_t(1) << shift) - 1);
+}
+
+void LatencyHistogram::Record(std::chrono::nanoseconds latency) noexcept {
+  uint64_t value = latency.count() < 0 ? 0 : latency.count();
+  buckets_[GetBucket(value)].fetch_add(1, std::memory_order_relaxed);
+  count_.fetch_add(1, std::memory_order_relaxed);
+  sum_.fetch_add(value, std::memory_order_relaxed);
+
+  uint64_t max = max_.load(std::memory_order_relaxed);
+  while (value > max &&
+         !max_.compare_exchange_weak(max, value, std::memory_order_relaxed)) {
+  }
+}
+
+LatencyStats LatencyHistogram::GetStats() const noexcept {
+  uint64_t buckets[kBuckets];
+  uint64_t count = 0;
+  for (int i = 0; i < kBuckets; ++i) {
+    buckets[i] = buckets_[i].load(std::memory_order_relaxed);
+    count += buckets[i];
+  }
+
+  LatencyStats stats;
+  stats.count = count;
+  if (count == 0) {
+    return stats;
+  }
+  stats.mean = std::chrono::nanoseconds(
+      sum_.load(std::memory_order_relaxed) /
+      std::max<uint64_t>(count_.load(std::memory_order_relaxed), 1));
+  stats.max = std::chrono::nanoseconds(max_.load(std::memory_order_relaxed));
+
+  std::pair<double, std::chrono::nanoseconds*> percentiles[] = {
+      {0.5, &stats.p50}, {0.9, &stats.p90}, {0.99, &stats.p99},
+      {0.999, &stats.p999}};
+  uint64_t seen = 0;
+  int bucket = 0;
+  for (auto& [quantile, result] : percentiles) {
+    auto rank = static_cast<uint64_t>(quantile * (count - 1)) + 1;
+    while (seen + buckets[bucket] < rank) {
+      seen += buckets[bucket];
+      ++bucket;
+    }
+    *result = std::min(std::chrono::nanoseconds(GetBucketTop(bucket)),
+                       stats.max);
+  }
+  return stats;
+}
+
+void CountedMutex::lock() {
+  if (!mutex_.try_lock()) {
+    contended_.fetch_add(1, std::memory_order_relaxed);
+    mutex_.lock();
+  }
+  acquisitions_.fetch_add(1, std::memory_order_relaxed);
+}
+bool CountedMutex::try_lock() noexcept {
+  if (!mutex_.try_lock()) {
+    return false;
+  }
+  acquisitions_.fetch_add(1, std::memory_order_relaxed);
+  return true;
+}
+void CountedMutex::unlock() noexcept { mutex_.unlock(); }
+
+MutexStats CountedMutex::GetStats(const std::string& name) const noexcept {
+  return {.name = name,
+          .acquisitions = acquisitions_.load(std::memory_order_relaxed),
+          .contended = contended_.load(std::memory_order_relaxed)};
+}
+
+}  // namespace LNCR
\ No newline at end of file
@@ -1,17 +1,24 @@
 #pragma once
 
+#include <atomic>
 #include <chrono>
+#include <condition_variable>
+#include <deque>
 #include <list>
 #include <map>
 #include <mutex>
 #include <optional>
 #include <semaphore>
+#include <set>
 #include <string>
 #include <thread>
 #include <vector>
 
+#include "clauncher-config.hpp"
+#include "clauncher-metrics.hpp"
 #include "clauncher-server.hpp"
 #include "clauncher-supply.hpp"
+#include "clauncher-trace.hpp"
 #include "tcp-server.hpp"
 
 namespace LNCR {
@@ -21,6 +28,16 @@ struct LauncherServer::Implementation {
   struct ProcessInfo {
     ProcessConfig config;
     int pid = 0;
+    // last WATCHDOG=1, set when the main table takes the process
+    std::optional<std::chrono::time_point<std::chrono::system_clock>>
+        watchdog = {};
+    // stop sequence of a hung process
+    std::optional<std::chrono::time_point<std::chrono::system_clock>>
+        watchdog_term_sent = {};
+    // cpu time of the last sample and when it has changed
+    uint64_t cpu_time = 0;
+    std::optional<std::chrono::time_point<std::chrono::system_clock>>
+        active = {};
   };
   struct Runner {
     ProcessInfo info;
@@ -29,6 +46,18 @@ struct LauncherServer::Implementation {
 
     int* run_status = nullptr;
     std::binary_semaphore* run_semaphore = nullptr;
+
+    TraceContext trace = {};
+    std::chrono::time_point<std::chrono::system_clock> queued =
+        std::chrono::system_clock::now();
+    std::optional<std::chrono::time_point<std::chrono::system_clock>>
+        registered = {};  // agent handshake time
+    std::optional<std::chrono::time_point<std::chrono::system_clock>>
+        ready = {};  // READY=1 time
+    // on demand process waits for a connection since
+    std::optional<std::chrono::time_point<std::chrono::system_clock>>
+        armed = {};
+    bool is_throttled = false;  // launch is delayed by admission control
   };
   struct Stopper {
     std::optional<std::chrono::time_point<std::chrono::system_clock>>
@@ -36,29 +65,103 @@ struct LauncherServer::Implementation {
 
     int* term_status = nullptr;
     std::binary_semaphore* term_semaphore = nullptr;
+
+    std::chrono::time_point<std::chrono::system_clock> requested =
+        std::chrono::system_clock::now();
+    bool is_idle = false;  // armed again when stopped
   };
 
   struct Client {
     std::optional<TCP::TcpClient> connection = {};
     std::optional<std::thread> curr_communication = {};
     bool is_running = false;
+    std::chrono::time_point<std::chrono::system_clock> available = {};
+  };
+  struct Subscriber {
+    std::deque<ProcessEvent> events = {};
+    int lost = 0;
+  };
+  // old instance of a rolling restart
+  struct Retiring {
+    std::string bin_name;
+    ProcessInfo info;
+    // not set while the new instance is starting
+    std::optional<std::chrono::time_point<std::chrono::system_clock>>
+        term_sent = {};
+  };
+  struct Listeners {
+    std::vector<uint16_t> ports;
+    std::vector<int> fds;
+  };
+  struct TokenBucket {
+    double tokens = 0;
+    std::optional<std::chrono::time_point<std::chrono::system_clock>>
+        updated = {};  // starts full
+  };
+  struct DiffEntry {
+    std::string bin_name;
+    ApplyAction action;
+    ProcessConfig config = {};
   };
 
   // boot configuration //
   void GetConfig() noexcept;
-  void SaveConfig() const noexcept;
+  bool SaveConfig(const BootConfig& load_config) const noexcept;
+  // load_conf_m_ must be locked
+  void AppendJournal(const std::string& record) noexcept;
+  void SyncJournal() noexcept;
+  // snapshot of load config replacing the journal, forced or on big journal
+  void CompactConfig(bool force = false) noexcept;
+  void UpdateBootConfig(const std::string& bin_name,
+                        const ProcessConfig& process, Logger& logger) noexcept;
+  std::map<std::string, ApplyResult> ReloadConfig() noexcept;
+
+  // handover //
+  // saves live processes and removes them from the tables
+  void SaveHandover() noexcept;
+  // takes processes saved by the previous server if they are still alive
+  void AdoptProcesses() noexcept;
+
+  // shutdown //
+  // SIGTERM to every running process at once, waits for exits in parallel
+  std::vector<StopTiming> StopAll(
+      std::chrono::time_point<std::chrono::system_clock> deadline) noexcept;
+
+  // state reconciliation //
+  // boot_only: only boot config entries are managed, not running unchanged
+  // ones are not started
+  std::vector<DiffEntry> DiffState(const BootConfig& desired,
+                                   bool boot_only) noexcept;
+  std::map<std::string, ApplyResult> ApplyDiff(
+      std::vector<DiffEntry>&& diff, size_t max_parallel,
+      const Deadline& deadline) noexcept;
+  ApplyResult ApplyEntry(const DiffEntry& entry,
+                         const Deadline& deadline) noexcept;
+  // processes not in desired are stopped
+  std::map<std::string, ApplyResult> ApplyDesiredState(
+      const BootConfig& desired, size_t max_parallel,
+      const Deadline& deadline = {}) noexcept;
 
   // thread functions //
   void Accepter() noexcept;
   void Receiver() noexcept;
   void ProcessCtrl() noexcept;
+  void Notifier() noexcept;
+  void Activator() noexcept;
+  void CheckWatchdog(const std::string& bin_name, ProcessInfo& info) noexcept;
+  void CheckIdle(const std::string& bin_name, ProcessInfo& info) noexcept;
 
   void ClientCommunication(std::list<Client>::iterator* client) noexcept;
 
-  bool RunProcess(std::string&& bin_name, ProcessConfig&& process,
-                  bool wait_for_run = false) noexcept;
+  RunStatus RunProcess(std::string&& bin_name, ProcessConfig&& process,
+                       bool wait_for_run = false, const Deadline& deadline = {},
+                       TraceContext trace = {}) noexcept;
   TermStatus StopProcess(const std::string& bin_name,
-                         bool wait_for_term = false) noexcept;
+                         bool wait_for_term = false,
+                         const Deadline& deadline = {}) noexcept;
+  RunStatus RerunProcess(std::string&& bin_name, bool wait_for_rerun = false,
+                         const Deadline& deadline = {}) noexcept;
+  bool CancelWaits(const std::string& bin_name) noexcept;
 
   // atomic operations //
   void ALoad(TCP::TcpClient& client);
@@ -66,54 +169,166 @@ struct LauncherServer::Implementation {
   void ARerun(TCP::TcpClient& client);
   void AIsRunning(TCP::TcpClient& client);
   void AGetPid(TCP::TcpClient& client);
+  void ASubscribe(TCP::TcpClient& client);
+  void ACancel(TCP::TcpClient& client);
+  void AGetStats(TCP::TcpClient& client);
+  void AGetTrace(TCP::TcpClient& client);
+  void AReload(TCP::TcpClient& client);
+  void AApplyState(TCP::TcpClient& client);
   // void AGetConfig(TCP::TcpServer::ClientConnection client);
   // void ASetConfig(TCP::TcpServer::ClientConnection client);
 
   // secondary functions //
-  void SendRun(const std::string& name, const ProcessConfig& config) noexcept;
+  // pid of the process if it is spawned by the spawner, 0 if the agent is
+  // run to register it, -1 if it cannot be launched
+  int SendRun(const std::string& name, const ProcessConfig& config,
+              uint64_t trace_id) noexcept;
+  void RegisterProcess(const std::string& bin_name, Runner& runner, int pid,
+                       Logger& logger) noexcept;
+  // takes launch tokens of the process and of the server
+  bool Admit(const std::string& bin_name, const ProcessConfig& config) noexcept;
+  bool IsUnderPressure(Logger& logger) noexcept;
+  void StartSpawner() noexcept;
+  void StopSpawner() noexcept;
+  // pid, 0 if exec has failed, nothing if the spawner is not available
+  std::optional<int> Spawn(const std::string& cgroup_procs,
+                           const std::vector<std::string>& args,
+                           const std::vector<char*>& envp,
+                           const std::vector<int>& listen_fds,
+                           Logger& logger) noexcept;
 
   void PrCtrlToRun() noexcept;
   void PrCtrlToTerm() noexcept;
   void ProcessChangeSend(int status, std::binary_semaphore*&, int*&,
                          Logger&) noexcept;
+  bool WaitForChange(std::binary_semaphore* semaphore,
+                     const Deadline& deadline) noexcept;
 
   void PrCtrlMain() noexcept;
+  void PrCtrlRetiring() noexcept;
+  // new instance is run before the old one is stopped
+  RunStatus RollingRestart(std::string&& bin_name, ProcessConfig&& process,
+                           const Deadline& deadline) noexcept;
+  // listening sockets of the process, kept open between its instances.
+  // Nothing if any port cannot be listened
+  std::optional<std::vector<int>> GetListenFds(const std::string& bin_name,
+                                const std::vector<uint16_t>& ports) noexcept;
+  void CloseUnusedListeners() noexcept;
+  // empty cgroups of the processes left all tables, busy ones are retried
+  // on the next tick
+  void RemoveUnusedCgroups() noexcept;
+  // process group (or the single process) is alive
   bool IsPidAvailable(int pid) const noexcept;
+  // signals process group of the process, SIGKILL also kills its cgroup
+  void KillProcess(const std::string& bin_name, int pid,
+                   int signal) const noexcept;
+  // SIGKILL to an instance not run yet, the cgroup is killed only if no old
+  // instance of a rolling restart shares it. retiring_m_ must not be locked
+  void KillStarting(const std::string& bin_name, int pid) noexcept;
+  std::string GetCgroupPath(const std::string& bin_name) const;
   std::optional<int> GetPid(const std::string& bin_name) noexcept;
   bool IsRunning(const std::string& bin_name) noexcept;
 
-  static const int kNumAMethods = 5;
+  void NotifySubscribers(ProcessEventType type, const std::string& bin_name,
+                         int value) noexcept;
+
+  ServerStats GetStats() noexcept;
+  void SendApplyResults(TCP::TcpClient& client,
+                        const std::map<std::string, ApplyResult>& results);
+
+  static const int kNumAMethods = 11;
   typedef void (Implementation::*MethodPtr)(TCP::TcpClient&);
   MethodPtr method_ptr[kNumAMethods] = {
       &Implementation::ALoad, &Implementation::AStop, &Implementation::ARerun,
-      &Implementation::AIsRunning, &Implementation::AGetPid};
+      &Implementation::AIsRunning, &Implementation::AGetPid,
+      &Implementation::ASubscribe, &Implementation::ACancel,
+      &Implementation::AGetStats, &Implementation::AGetTrace,
+      &Implementation::AReload, &Implementation::AApplyState};
 
   // variables //
-  std::map<std::string, ProcessConfig> load_config_;
-  std::mutex load_conf_m_;
+  BootConfig load_config_;
+  CountedMutex load_conf_m_;
+
+  // boot configuration journal: pending records are guarded by load_conf_m_,
+  // file by journal_m_. journal_m_ is locked before load_conf_m_
+  std::string journal_pending_;
+  uint64_t journal_records_ = 0;
+  uint64_t load_config_version_ = 0;
+  bool is_journaling_ = true;
+  std::mutex journal_m_;
+  int journal_fd_ = -1;
+  std::optional<uint64_t> snapshot_version_ = {};
+
+  std::mutex apply_m_;  // one reconciliation at a time
 
   std::map<std::string, ProcessInfo> processes_;
-  std::mutex pr_main_m_;
+  CountedMutex pr_main_m_;
 
   std::map<std::string, Runner> processes_to_run_;
-  std::mutex pr_to_run_m_;
+  CountedMutex pr_to_run_m_;
 
   std::map<std::string, Stopper> processes_to_terminate_;
-  std::mutex pr_to_term_m_;
+  CountedMutex pr_to_term_m_;
+
+  std::list<Retiring> retiring_;
+  std::mutex retiring_m_;  // locked after pr_to_term_m_
+
+  std::map<std::string, Listeners> listeners_;
+  std::mutex listeners_m_;  // locked after retiring_m_
+
+  std::set<std::string> cgroups_;  // created by SendRun
+  std::mutex cgroups_m_;           // locked after retiring_m_
 
   TCP::TcpServer tcp_server_;
   std::list<Client> clients_;
-  std::mutex clients_m_;
+  CountedMutex clients_m_;
+
+  std::list<Subscriber*> subscribers_;
+  std::mutex subscribers_m_;
+  std::condition_variable subscribers_cv_;
 
   std::string agent_binary_;
   std::string config_file_;
   int port_;
+  std::string cgroup_root_ = {};
 
   std::thread accepter_;
   std::thread receiver_;
   std::thread process_ctrl_;
+  std::thread notifier_;
+  std::thread activator_;
+
+  int notify_fd_ = -1;  // sd_notify datagram socket
+  std::string notify_path_ = {};
+
+  std::mutex spawner_m_;  // locked after pr_to_run_m_
+  int spawner_fd_ = -1;
+  int spawner_pid_ = 0;
+  std::optional<std::chrono::time_point<std::chrono::system_clock>>
+      spawner_failed_ = {};
 
   bool is_active_ = true;
+  bool is_shut_down_ = false;
+  std::atomic<bool> is_handover_ = false;
+
+  // launch admission //
+  std::mutex admission_m_;  // locked after pr_to_run_m_
+  AdmissionConfig admission_ = {};
+  TokenBucket launch_bucket_ = {};
+  std::map<std::string, TokenBucket> process_buckets_;
+
+  // stats //
+  std::chrono::steady_clock::time_point start_time_ =
+      std::chrono::steady_clock::now();
+  std::atomic<uint64_t> launches_ = 0;
+  std::atomic<uint64_t> restarts_ = 0;
+  std::atomic<uint64_t> watchdog_timeouts_ = 0;
+  std::atomic<uint64_t> idle_stops_ = 0;
+  std::atomic<uint64_t> throttled_launches_ = 0;
+  LatencyHistogram spawn_latency_;
+  LatencyHistogram stop_latency_;
+  LatencyHistogram control_loop_;
+  TraceBuffer trace_;
 
   logging_foo logger_;
 };
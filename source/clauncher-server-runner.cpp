@@ -1,6 +1,9 @@
 #include <signal.h>
 #include <unistd.h>
 
+#include <atomic>
+#include <thread>
+
 #include "clauncher-server.hpp"
 
 namespace LNCR {
@@ -8,17 +11,16 @@ namespace LNCR {
 LauncherServer* server;
 logging_foo global_logger;
 
-bool signal_caught = false;
-
-void TermHandler(int signal) {
-  LRunner l_runner(LRunner::SigHandler, global_logger);
-  Logger& logger = l_runner;
+volatile sig_atomic_t signal_caught = 0;
+volatile sig_atomic_t reload_requested = 0;
+volatile sig_atomic_t handover_requested = 0;
 
-  signal_caught = true;
-
-  logger.Log("Got signal " + std::to_string(signal), Info);
-  delete server;
-  logger.Log("Launcher server deleted. Terminating", Info);
+// only flags are set here, the main loop does the work
+void TermHandler(int signal) { signal_caught = signal; }
+void ReloadHandler(int) { reload_requested = 1; }
+void HandoverHandler(int signal) {
+  handover_requested = 1;
+  signal_caught = signal;
 }
 
 void SigTermSetup(int signal, void (*handler)(int)) {
@@ -37,23 +39,61 @@ void LauncherRunner(int port, const std::string& config_file,
   LRunner l_runner(LRunner::Main, global_logger);
   Logger& logger = l_runner;
 
-  logger.Log("Trying to set signal handling", Debug);
+  logger.Log(Debug, "Trying to set signal handling");
   SigTermSetup(SIGTERM, TermHandler);
-  logger.Log("Signal handler set", Info);
+  SigTermSetup(SIGHUP, ReloadHandler);
+  SigTermSetup(SIGUSR2, HandoverHandler);
+  logger.Log(Info, "Signal handler set");
 
   try {
-    logger.Log("Trying to create server", Info);
+    logger.Log(Info, "Trying to create server");
     server = new LauncherServer(port, config_file, agent_binary, global_logger);
-    logger.Log("Server created", Info);
+    logger.Log(Info, "Server created");
   } catch (std::exception& exception) {
-    logger.Log(std::string("Server creation failed: ") + exception.what(),
-               Error);
+    logger.Log(Error, "Server creation failed: {}", exception.what());
     return;
   }
 
+  // reload is applied by its own thread, so signals are handled meanwhile
+  std::thread reloader;
+  std::atomic<bool> is_reloading = false;
   while (!signal_caught) {
     sleep(1);
+    if (reload_requested && !is_reloading) {
+      reload_requested = 0;
+      LRunner l_handler(LRunner::SigHandler, global_logger);
+      l_handler.Log(Info, "Got reload signal");
+      if (reloader.joinable()) {
+        reloader.join();
+      }
+      is_reloading = true;
+      try {
+        reloader = std::thread([&is_reloading] {
+          LRunner l_reloader(LRunner::Reloader, global_logger);
+          auto results = server->ReloadConfig();
+          l_reloader.Log(Info, "Config reloaded: {} processes",
+                         results.size());
+          is_reloading = false;
+        });
+      } catch (std::system_error& error) {
+        l_handler.Log(Error, "Cannot create reload thread: {}", error.what());
+        is_reloading = false;
+      }
+    }
   }
+
+  LRunner l_handler(LRunner::SigHandler, global_logger);
+  l_handler.Log(Info, "Got signal {}", static_cast<int>(signal_caught));
+  if (reloader.joinable()) {
+    l_handler.Log(Info, "Waiting for the reload in progress");
+    reloader.join();
+  }
+  if (handover_requested) {
+    l_handler.Log(Info, "Processes are handed over to the next server");
+    server->EnableHandover();
+  }
+  delete server;
+  l_handler.Log(Info, "Launcher server deleted. Terminating");
 }
 
 }  // namespace LNCR
\ No newline at end of file
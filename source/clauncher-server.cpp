@@ -1,11 +1,24 @@
 #include "clauncher-server.hpp"
 
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
 #include <signal.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/un.h>
+#include <sys/wait.h>
 #include <unistd.h>
 
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
 #include <fstream>
 #include <iostream>
+#include <sstream>
 
+#include "clauncher-config.hpp"
 #include "clauncher-server-impl.hpp"
 
 namespace LNCR {
@@ -13,8 +26,38 @@ namespace LNCR {
 /*-------------------------------- constants ---------------------------------*/
 const std::chrono::milliseconds kWaitToRerun = std::chrono::milliseconds(100);
 const std::chrono::milliseconds kLoopWait = std::chrono::milliseconds(100);
+const size_t kSubscriberQueueSize = 1024;
+const char kJournalSuffix[] = ".journal";
+const char kSnapshotSuffix[] = ".tmp";
+const char kDamagedSuffix[] = ".damaged";
+const char kHandoverSuffix[] = ".handover";
+const char kNotifySuffix[] = ".notify";
+const char kNotifyAbstractPrefix[] = "@clauncher-notify-";
+const uint64_t kJournalCompactRecords = 1024;
+const size_t kApplyParallel = 16;
+// starts and stops of a reload not finished in time are reported failed
+const std::chrono::seconds kReloadTimeout = std::chrono::seconds(30);
+const std::chrono::seconds kShutdownTimeout = std::chrono::seconds(30);
+// exits are polled with this period if pidfd is not supported
+const std::chrono::milliseconds kShutdownPoll = std::chrono::milliseconds(10);
+const std::chrono::milliseconds kSpawnTimeout = std::chrono::milliseconds(1000);
+const std::chrono::seconds kSpawnerRetry = std::chrono::seconds(10);
+
+// timings of the request served by the client communication thread
+struct RequestTiming {
+  std::chrono::time_point<std::chrono::system_clock> available;
+  std::chrono::time_point<std::chrono::system_clock> started;
+};
+thread_local RequestTiming request_timing;
 
 /*--------------------------- secondary functions ----------------------------*/
+Deadline TimeoutToDeadline(int64_t timeout) {
+  if (timeout == 0) {
+    return {};
+  }
+  return std::chrono::system_clock::now() + std::chrono::milliseconds(timeout);
+}
+
 std::list<std::string> Split(const std::string& string, const char& delimiter) {
   std::list<std::string> split;
   size_t start_from = 0;
@@ -30,267 +73,974 @@ std::list<std::string> Split(const std::string& string, const char& delimiter) {
   return split;
 }
 
+// equal in the fields applied when the process is exec'd, the others
+// (launch on boot, rolling restart, ready timeout, idle timeout, priority,
+// launch limit) are changed in the live entry without a restart
+bool IsSameRuntime(const ProcessConfig& first, const ProcessConfig& second) {
+  return first.args == second.args && first.term_rerun == second.term_rerun &&
+         first.time_to_stop == second.time_to_stop &&
+         first.listen_ports == second.listen_ports &&
+         first.on_demand == second.on_demand &&
+         first.watchdog_interval == second.watchdog_interval;
+}
+
+bool WriteAll(int fd, const std::string& data) {
+  size_t written = 0;
+  while (written < data.size()) {
+    ssize_t result = write(fd, data.data() + written, data.size() - written);
+    if (result < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+    written += result;
+  }
+  return true;
+}
+
+// numeric fields of /proc/<pid>/stat from the 3rd (state is 0)
+std::vector<uint64_t> ReadStat(int pid) {
+  std::ifstream stat_file("/proc/" + std::to_string(pid) + "/stat");
+  std::string stat;
+  if (!std::getline(stat_file, stat)) {
+    return {};
+  }
+  auto comm_end = stat.rfind(')');  // comm may contain spaces and brackets
+  if (comm_end == std::string::npos) {
+    return {};
+  }
+  std::istringstream fields(stat.substr(comm_end + 1));
+  std::string state;
+  fields >> state;
+  std::vector<uint64_t> values = {0};
+  int64_t value;
+  while (fields >> value) {
+    values.push_back(value);
+  }
+  return values;
+}
+// start time of the process, distinguishes it from a later one with the
+// same pid
+std::optional<uint64_t> ReadStartTime(int pid) {
+  auto stat = ReadStat(pid);
+  if (stat.size() <= 22 - 3) {
+    return {};
+  }
+  return stat[22 - 3];
+}
+// utime, stime and waited children times in clock ticks
+std::optional<uint64_t> ReadCpuTime(int pid) {
+  auto stat = ReadStat(pid);
+  if (stat.size() <= 17 - 3) {
+    return {};
+  }
+  return stat[14 - 3] + stat[15 - 3] + stat[16 - 3] + stat[17 - 3];
+}
+// usage_usec of cpu.stat, counts every process of the cgroup
+std::optional<uint64_t> ReadCgroupCpuTime(const std::string& cgroup) {
+  std::ifstream stat_file(cgroup + "/cpu.stat");
+  std::string key;
+  uint64_t value;
+  while (stat_file >> key >> value) {
+    if (key == "usage_usec") {
+      return value;
+    }
+  }
+  return {};
+}
+
+// "some avg10" of /proc/pressure/<resource>, nothing without PSI
+std::optional<double> ReadPressure(const char* resource) {
+  std::ifstream pressure_file(std::string("/proc/pressure/") + resource);
+  std::string kind, average;
+  if (!(pressure_file >> kind >> average) || kind != "some" ||
+      average.rfind("avg10=", 0) != 0) {
+    return {};
+  }
+  return std::strtod(average.c_str() + 6, nullptr);
+}
+
+// established tcp connections on one of the local ports
+bool HasConnections(const std::vector<uint16_t>& ports) {
+  for (const char* table : {"/proc/net/tcp", "/proc/net/tcp6"}) {
+    std::ifstream table_file(table);
+    std::string line;
+    std::getline(table_file, line);  // header
+    while (std::getline(table_file, line)) {
+      // sl local_address:port rem_address:port st ...
+      std::istringstream fields(line);
+      std::string number, local, remote, state;
+      if (!(fields >> number >> local >> remote >> state) || state != "01") {
+        continue;
+      }
+      auto port = std::strtoul(local.c_str() + local.rfind(':') + 1,
+                               nullptr, 16);
+      if (std::find(ports.begin(), ports.end(), port) != ports.end()) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+// descriptor becoming readable when the process exits, -1 if not supported
+int OpenPidFd(int pid) {
+#ifdef SYS_pidfd_open
+  return syscall(SYS_pidfd_open, pid, 0);
+#else
+  return -1;
+#endif
+}
+
+// writes temporary file and renames it over path
+bool ReplaceFile(const std::string& path, const std::string& data,
+                 Logger& logger) {
+  logger.Log(Debug, "Writing temporary file");
+  auto temporary = path + kSnapshotSuffix;
+  int fd = open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+                0644);
+  if (fd == -1) {
+    logger.Log(Warning, "Error while opening file: {}", strerror(errno));
+    return false;
+  }
+  if (!WriteAll(fd, data) || fsync(fd) != 0) {
+    logger.Log(Warning, "Error while writing file: {}", strerror(errno));
+    close(fd);
+    return false;
+  }
+  close(fd);
+
+  logger.Log(Debug, "Replacing file");
+  if (rename(temporary.c_str(), path.c_str()) != 0) {
+    logger.Log(Warning, "Error while renaming file: {}", strerror(errno));
+    return false;
+  }
+  auto directory = std::filesystem::path(path).parent_path();
+  int directory_fd = open(directory.empty() ? "." : directory.c_str(),
+                          O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (directory_fd != -1) {
+    fsync(directory_fd);
+    close(directory_fd);
+  }
+  return true;
+}
+
+// rolling restart, listening ports and readiness following the args
+bool ReceiveLaunchOptions(TCP::TcpClient& client, ProcessConfig& config) {
+  int ports_num;
+  if (!client.Receive(client.GetMsPingThreshold(), config.rolling_restart,
+                      config.on_demand, ports_num)) {
+    return false;
+  }
+  for (int i = 0; i < ports_num; ++i) {
+    int port;
+    if (!client.Receive(client.GetMsPingThreshold(), port)) {
+      return false;
+    }
+    config.listen_ports.push_back(port);
+  }
+  int64_t ready_timeout, watchdog_interval, idle_timeout, launch_interval;
+  int launch_burst;
+  if (!client.Receive(client.GetMsPingThreshold(), ready_timeout) ||
+      !client.Receive(client.GetMsPingThreshold(), watchdog_interval) ||
+      !client.Receive(client.GetMsPingThreshold(), idle_timeout) ||
+      !client.Receive(client.GetMsPingThreshold(), config.priority,
+                      launch_burst, launch_interval)) {
+    return false;
+  }
+  if (launch_burst > 0) {
+    config.launch_limit = {
+        .interval = std::chrono::milliseconds(launch_interval),
+        .burst = static_cast<uint32_t>(launch_burst)};
+  }
+  if (ready_timeout != 0) {
+    config.ready_timeout = std::chrono::milliseconds(ready_timeout);
+  }
+  if (watchdog_interval != 0) {
+    config.watchdog_interval = std::chrono::milliseconds(watchdog_interval);
+  }
+  if (idle_timeout != 0) {
+    config.idle_timeout = std::chrono::milliseconds(idle_timeout);
+  }
+  return true;
+}
+
+// datagram socket receiving sender credentials, -1 on error
+// path starting with '@' is an abstract socket name, as in NOTIFY_SOCKET
+int OpenNotifySocket(const std::string& path) {
+  sockaddr_un address = {};
+  address.sun_family = AF_UNIX;
+  if (path.size() >= sizeof(address.sun_path)) {
+    errno = ENAMETOOLONG;
+    return -1;
+  }
+  std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+  socklen_t address_size = sizeof(address);
+  if (path[0] == '@') {
+    address.sun_path[0] = '\0';
+    address_size = offsetof(sockaddr_un, sun_path) + path.size();
+  }
+
+  int fd = socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+  if (fd == -1) {
+    return -1;
+  }
+  int enable = 1;
+  if (path[0] != '@') {
+    unlink(path.c_str());  // left by the previous server
+  }
+  if (bind(fd, reinterpret_cast<sockaddr*>(&address), address_size) != 0 ||
+      setsockopt(fd, SOL_SOCKET, SO_PASSCRED, &enable, sizeof(enable)) != 0) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+// bound, listening and close-on-exec socket, -1 on error
+int OpenListener(uint16_t port) {
+  int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (fd == -1) {
+    return -1;
+  }
+  int enable = 1;
+  // instances of the previous server may still hold the port
+  setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+  setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &enable, sizeof(enable));
+  sockaddr_in address = {};
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_ANY);
+  address.sin_port = htons(port);
+  if (bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+      listen(fd, SOMAXCONN) != 0) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+void SendLatency(TCP::TcpClient& client, const LatencyStats& stats) {
+  client.Send(stats.count, stats.mean.count(), stats.p50.count(),
+              stats.p90.count(), stats.p99.count(), stats.p999.count(),
+              stats.max.count());
+}
+
 void LauncherServer::Implementation::PrCtrlToRun() noexcept {
   LServer l_server(LServer::PrCtrlToRun, logger_);
   Logger& logger = l_server;
-  logger.Log("Starting function", Debug);
+  logger.Log(Debug, "Starting function");
 
-  logger.Log("Locking mutex", Debug);
+  logger.Log(Debug, "Locking mutex");
   pr_to_run_m_.lock();
-  logger.Log("Mutex locked. Entering loop", Debug);
+  logger.Log(Debug, "Mutex locked. Entering loop");
+  std::vector<decltype(processes_to_run_)::iterator> launches;
   for (auto iter = processes_to_run_.begin();
        iter != processes_to_run_.end();) {
     auto& [bin_name, runner] = *iter;
-    logger.Log("Processing " + bin_name, Info);
+    logger.Log(Info, "Processing {}", bin_name);
+    if (runner.armed.has_value()) {
+      logger.Log(Debug, "Process is spawned on demand");
+      ++iter;
+      continue;
+    }
+    if (runner.info.pid != 0 && runner.info.config.ready_timeout.has_value() &&
+        !runner.ready.has_value()) {  // waiting for readiness
+      logger.Log(Info, "Process has sent config, but is not ready");
+      bool is_exited = !IsPidAvailable(runner.info.pid);
+      if (!is_exited && std::chrono::system_clock::now() -
+                                runner.registered.value_or(runner.queued) <=
+                            runner.info.config.ready_timeout.value()) {
+        ++iter;
+        continue;
+      }
+      if (is_exited) {
+        logger.Log(Warning, "Process has exited before being ready");
+        NotifySubscribers(Exited, bin_name, runner.info.pid);
+      } else {
+        logger.Log(Warning, "Process is not ready in time. Killing");
+        KillStarting(bin_name, runner.info.pid);
+        NotifySubscribers(Killed, bin_name, SigKill);
+      }
+      ProcessChangeSend(RunFailed, runner.run_semaphore, runner.run_status,
+                        logger);
+      if (!runner.info.config.term_rerun) {
+        iter = processes_to_run_.erase(iter);
+        continue;
+      }
+      // a readiness failure is rerun as any other exit
+      logger.Log(Info, "Process's rerun flag is set to true. Rerunning");
+      NotifySubscribers(Restarting, bin_name, runner.info.pid);
+      restarts_.fetch_add(1, std::memory_order_relaxed);
+      runner = {.info = {.config = std::move(runner.info.config)},
+                .trace = {.trace_id = NewTraceId()}};
+    }
     if (runner.info.pid != 0) {  // process has already sent config
-      logger.Log("Process has already sent config. Moving to main table", Info);
+      logger.Log(Info, "Process has already sent config. Moving to main table");
       processes_.insert({bin_name, runner.info});
+      NotifySubscribers(Started, bin_name, runner.info.pid);
+      auto now = std::chrono::system_clock::now();
+      if (runner.ready.has_value()) {
+        NotifySubscribers(Ready, bin_name, runner.info.pid);
+        trace_.Record(runner.trace.trace_id, "ready", bin_name,
+                      runner.registered.value_or(runner.queued),
+                      runner.ready.value());
+      }
+      if (runner.registered.has_value()) {
+        trace_.Record(runner.trace.trace_id, "promote", bin_name,
+                      runner.ready.value_or(runner.registered.value()), now);
+      }
+      trace_.Record(runner.trace.trace_id, "launch", bin_name,
+                    runner.trace.started.value_or(runner.queued), now);
 
-      ProcessChangeSend(true, runner.run_semaphore, runner.run_status, logger);
+      ProcessChangeSend(RunSucceeded, runner.run_semaphore, runner.run_status,
+                        logger);
 
-      logger.Log("Process successfully run. Erasing from Run table", Info);
+      logger.Log(Info, "Process successfully run. Erasing from Run table");
       iter = processes_to_run_.erase(iter);
       continue;
     }
 
     if (runner.last_run.has_value()) {  // process run but has not sent config
-      logger.Log("Process is running but has not sent config", Info);
+      logger.Log(Info, "Process is running but has not sent config");
       if (std::chrono::system_clock::now() - runner.last_run.value() >=
           kWaitToRerun) {      // is timeout
         runner.last_run = {};  // setting rerun flag
-        logger.Log("Launching timeout. Rerunning", Info);
+        runner.queued = std::chrono::system_clock::now();
+        logger.Log(Info, "Launching timeout. Rerunning");
       } else {
-        logger.Log("Launching not timeout", Debug);
+        logger.Log(Debug, "Launching not timeout");
       }
     }
 
     if (is_active_ && runner.info.pid == 0 &&
         !runner.last_run.has_value()) {  // run flag set
-      runner.last_run = std::chrono::system_clock::now();
-      SendRun(bin_name, runner.info.config);
-      logger.Log("Set run flag. Agent has been run", Info);
+      launches.push_back(iter);
     }
     ++iter;
   }
+
+  // admitted in priority order, the earliest queued first
+  std::sort(launches.begin(), launches.end(), [](auto first, auto second) {
+    return first->second.info.config.priority >
+               second->second.info.config.priority ||
+           (first->second.info.config.priority ==
+                second->second.info.config.priority &&
+            first->second.queued < second->second.queued);
+  });
+  bool is_pressured = !launches.empty() && IsUnderPressure(logger);
+  for (auto launch : launches) {
+    auto& [bin_name, runner] = *launch;
+    if (is_pressured || !Admit(bin_name, runner.info.config)) {
+      if (!runner.is_throttled) {
+        logger.Log(Info, "Launch of {} is delayed by admission control",
+                   bin_name);
+        runner.is_throttled = true;
+        throttled_launches_.fetch_add(1, std::memory_order_relaxed);
+      }
+      continue;
+    }
+    runner.is_throttled = false;
+    runner.last_run = std::chrono::system_clock::now();
+    trace_.Record(runner.trace.trace_id, "ctrl wait", bin_name, runner.queued,
+                  runner.last_run.value());
+    int pid = SendRun(bin_name, runner.info.config, runner.trace.trace_id);
+    if (pid == -1) {
+      logger.Log(Warning, "Process {} cannot be launched", bin_name);
+      ProcessChangeSend(RunFailed, runner.run_semaphore, runner.run_status,
+                        logger);
+      processes_to_run_.erase(launch);
+      continue;
+    }
+    if (pid != 0) {
+      RegisterProcess(bin_name, runner, pid, logger);
+    }
+    logger.Log(Info, "Set run flag. Agent has been run");
+  }
   pr_to_run_m_.unlock();
-  logger.Log("Mutex unlocked", Debug);
+  logger.Log(Debug, "Mutex unlocked");
 }
 void LauncherServer::Implementation::PrCtrlToTerm() noexcept {
   LServer l_server(LServer::PrCtrlToTerm, logger_);
   Logger& logger = l_server;
-  logger.Log("Starting function", Debug);
+  logger.Log(Debug, "Starting function");
 
-  logger.Log("Locking mutex", Debug);
+  logger.Log(Debug, "Locking mutex");
   pr_main_m_.lock();
-  pr_to_run_m_.unlock();
+  pr_to_run_m_.lock();
   pr_to_term_m_.lock();
-  logger.Log("Mutex locked. Entering loop", Debug);
-
+  logger.Log(Debug, "Mutex locked. Entering loop");
+
+  // idle process keeps its sockets and waits for the next connection
+  auto erase_main = [this, &logger](auto main_iter, const Stopper& deleter) {
+    if (deleter.is_idle) {
+      logger.Log(Info, "Idle process is stopped. Waiting for connection");
+      Runner runner = {.info = {.config = std::move(main_iter->second.config)},
+                       .trace = {.trace_id = NewTraceId()}};
+      runner.armed = runner.queued;
+      processes_to_run_.insert({main_iter->first, std::move(runner)});
+    }
+    processes_.erase(main_iter);
+  };
   for (auto iter = processes_to_terminate_.begin();
        iter != processes_to_terminate_.end();) {
     auto& [bin_name, deleter] = *iter;
-    logger.Log("Processing " + bin_name, Info);
+    logger.Log(Info, "Processing {}", bin_name);
 
     if (processes_.contains(bin_name)) {  // Main table contains process
-      logger.Log("Main table contains process", Info);
+      logger.Log(Info, "Main table contains process");
       auto main_iter = processes_.find(bin_name);
       if (!IsPidAvailable(
               processes_[bin_name].pid)) {  // Process is not running
-        logger.Log("Process has already terminated. Erasing from main talbe",
-                   Info);
-        processes_.erase(main_iter);
+        logger.Log(Info,
+                   "Process has already terminated. Erasing from main talbe");
+        erase_main(main_iter, deleter);
+        NotifySubscribers(Killed, bin_name, SigTerm);
+        stop_latency_.Record(std::chrono::system_clock::now() -
+                             deleter.requested);
         ProcessChangeSend(SigTerm, deleter.term_semaphore, deleter.term_status,
                           logger);
-        logger.Log("Erasing from Term table", Debug);
+        logger.Log(Debug, "Erasing from Term table");
         iter = processes_to_terminate_.erase(iter);
         continue;
       }
       // Process is running
-      logger.Log("Process is running", Info);
+      logger.Log(Info, "Process is running");
 
       if (!deleter.term_sent.has_value()) {  // SigTerm has not been sent yet
-        logger.Log("SigTerm signal has not been sent yet. Sending SIGTERM",
-                   Info);
-        kill(main_iter->second.pid, SIGTERM);
+        logger.Log(Info,
+                   "SigTerm signal has not been sent yet. Sending SIGTERM");
+        KillProcess(bin_name, main_iter->second.pid, SIGTERM);
         if (!main_iter->second.config.time_to_stop
                  .has_value()) {  // no checking required
-          logger.Log(
-              "Checking termination is not required. Erasing from Main talbe",
-              Info);
-          processes_.erase(main_iter);
+          logger.Log(Info,
+                     "Checking termination is not required. Erasing from Main "
+                     "talbe");
+          erase_main(main_iter, deleter);
+          NotifySubscribers(Killed, bin_name, NoCheck);
+          stop_latency_.Record(std::chrono::system_clock::now() -
+                               deleter.requested);
           ProcessChangeSend(NoCheck, deleter.term_semaphore,
                             deleter.term_status, logger);
-          logger.Log("Erasing from Term table", Debug);
+          logger.Log(Debug, "Erasing from Term table");
           iter = processes_to_terminate_.erase(iter);
           continue;
         }
-        logger.Log("Termination checker is required. Setting timer", Info);
+        logger.Log(Info, "Termination checker is required. Setting timer");
         deleter.term_sent = std::chrono::system_clock::now();
       } else if (std::chrono::system_clock::now() - deleter.term_sent.value() >
                  main_iter->second.config.time_to_stop.value()) {  // timeout
-        logger.Log(
-            "SigTerm signal has already been sent. Timer timeout. Sending "
-            "SIGKILL. Erasing from Main table",
-            Info);
-        kill(main_iter->second.pid, SIGKILL);
-        processes_.erase(main_iter);
+        logger.Log(Info,
+                   "SigTerm signal has already been sent. Timer timeout. "
+                   "Sending SIGKILL. Erasing from Main table");
+        KillProcess(bin_name, main_iter->second.pid, SIGKILL);
+        erase_main(main_iter, deleter);
+        NotifySubscribers(Killed, bin_name, SigKill);
+        stop_latency_.Record(std::chrono::system_clock::now() -
+                             deleter.requested);
         ProcessChangeSend(SigKill, deleter.term_semaphore, deleter.term_status,
                           logger);
-        logger.Log("Erasing from Term table", Debug);
+        logger.Log(Debug, "Erasing from Term table");
         iter = processes_to_terminate_.erase(iter);
         continue;
       }
       // not timeout
-      logger.Log("Timer is not timeout. Moving to next process", Info);
+      logger.Log(Info, "Timer is not timeout. Moving to next process");
     } else if (processes_to_run_.contains(
                    bin_name)) {  // Run table contains process
-      logger.Log("Run table contains process", Info);
+      logger.Log(Info, "Run table contains process");
       auto run_iter = processes_to_run_.find(bin_name);
       if (run_iter->second.info.pid == 0) {  // Process has no PID
-        logger.Log("Process has no PID. Erasing from Run table", Info);
+        logger.Log(Info, "Process has no PID. Erasing from Run table");
         processes_to_run_.erase(run_iter);
+        NotifySubscribers(Killed, bin_name, NotRun);
+        stop_latency_.Record(std::chrono::system_clock::now() -
+                             deleter.requested);
         ProcessChangeSend(NotRun, deleter.term_semaphore, deleter.term_status,
                           logger);
-        logger.Log("Erasing process from Term table", Debug);
+        logger.Log(Debug, "Erasing process from Term table");
+        iter = processes_to_terminate_.erase(iter);
+        continue;
+      }
+      auto& runner = run_iter->second;
+      if (runner.info.config.ready_timeout.has_value() &&
+          !runner.ready.has_value()) {  // would hold the stop for long
+        logger.Log(Info, "Process is not ready. Killing");
+        KillStarting(bin_name, runner.info.pid);
+        ProcessChangeSend(RunFailed, runner.run_semaphore, runner.run_status,
+                          logger);
+        processes_to_run_.erase(run_iter);
+        NotifySubscribers(Killed, bin_name, SigKill);
+        stop_latency_.Record(std::chrono::system_clock::now() -
+                             deleter.requested);
+        ProcessChangeSend(SigKill, deleter.term_semaphore, deleter.term_status,
+                          logger);
+        logger.Log(Debug, "Erasing process from Term table");
         iter = processes_to_terminate_.erase(iter);
         continue;
       }
-      logger.Log("Process has got PID. Moving to next process", Info);
+      logger.Log(Info, "Process has got PID. Moving to next process");
     } else {  // No table contains process
-      logger.Log("Not table contains process", Info);
+      logger.Log(Info, "Not table contains process");
       ProcessChangeSend(NotRunning, deleter.term_semaphore, deleter.term_status,
                         logger);
-      logger.Log("Erasing process from Term table", Debug);
+      logger.Log(Debug, "Erasing process from Term table");
       iter = processes_to_terminate_.erase(iter);
       continue;
     }
     ++iter;
   }
 
-  logger.Log("Unlocking mutex", Debug);
+  logger.Log(Debug, "Unlocking mutex");
   pr_to_term_m_.unlock();
   pr_to_run_m_.unlock();
   pr_main_m_.unlock();
-  logger.Log("Function finish", Info);
+  logger.Log(Info, "Function finish");
 }
 
 void LauncherServer::Implementation::ProcessChangeSend(
     int status, std::binary_semaphore*& semaphore, int*& status_ptr,
     LNCR::Logger& logger) noexcept {
   if (semaphore == nullptr) {
-    logger.Log("Nothing is waiting for result", Debug);
+    logger.Log(Debug, "Nothing is waiting for result");
     return;
   }
 
-  logger.Log("Something is waiting for result, sending result", Info);
+  logger.Log(Info, "Something is waiting for result, sending result");
   *status_ptr = status;
   semaphore->release();
 
   status_ptr = nullptr;
   semaphore = nullptr;
 
-  logger.Log("Result sent", Debug);
+  logger.Log(Debug, "Result sent");
+}
+bool LauncherServer::Implementation::WaitForChange(
+    std::binary_semaphore* semaphore, const Deadline& deadline) noexcept {
+  if (!deadline.has_value()) {
+    semaphore->acquire();
+    return true;
+  }
+  return semaphore->try_acquire_until(deadline.value());
 }
 
 void LauncherServer::Implementation::PrCtrlMain() noexcept {
   LServer l_server(LServer::PrCtrlMain, logger_);
   Logger& logger = l_server;
-  logger.Log("Starting function", Debug);
+  logger.Log(Debug, "Starting function");
 
-  logger.Log("Locking mutex", Debug);
+  logger.Log(Debug, "Locking mutex");
   pr_main_m_.lock();
-  logger.Log("Mutex locked. Entering loop", Debug);
+  logger.Log(Debug, "Mutex locked. Entering loop");
   for (auto iter = processes_.begin(); iter != processes_.end();) {
-    logger.Log("Processing process " + iter->first, Info);
+    logger.Log(Info, "Processing process {}", iter->first);
     if (!processes_to_terminate_.contains(iter->first)) {
-      logger.Log("Process is not to terminate", Info);
+      logger.Log(Info, "Process is not to terminate");
       if (!IsPidAvailable(iter->second.pid)) {
-        logger.Log("Process is not running", Info);
+        logger.Log(Info, "Process is not running");
+        NotifySubscribers(Exited, iter->first, iter->second.pid);
         if (iter->second.config.term_rerun) {
-          logger.Log("Prosess's rerun flag is set to true. Rerunning", Info);
+          logger.Log(Info, "Prosess's rerun flag is set to true. Rerunning");
+          NotifySubscribers(Restarting, iter->first, iter->second.pid);
+          restarts_.fetch_add(1, std::memory_order_relaxed);
           auto bin_name = iter->first;
           auto config = std::move(iter->second.config);
-          logger.Log("Process erasing from main table", Info);
+          logger.Log(Info, "Process erasing from main table");
           iter = processes_.erase(iter);
 
           pr_main_m_.unlock();
-          logger.Log("Mutex unlocked", Debug);
+          logger.Log(Debug, "Mutex unlocked");
 
           RunProcess(std::move(bin_name), std::move(config));
 
-          logger.Log("Locking mutex", Debug);
+          logger.Log(Debug, "Locking mutex");
           pr_main_m_.lock();
-          logger.Log("Mutex locked", Debug);
+          logger.Log(Debug, "Mutex locked");
 
+        } else if (iter->second.config.on_demand &&
+                   !iter->second.config.listen_ports.empty()) {
+          logger.Log(Info, "Process is run on demand. Waiting for connection");
+          auto bin_name = iter->first;
+          auto config = std::move(iter->second.config);
+          iter = processes_.erase(iter);
+          pr_main_m_.unlock();
+          RunProcess(std::move(bin_name), std::move(config));
+          pr_main_m_.lock();
         } else {
-          logger.Log("Process's rerun flag is set to false", Debug);
-          logger.Log("Process erasing from main table", Info);
+          logger.Log(Debug, "Process's rerun flag is set to false");
+          logger.Log(Info, "Process erasing from main table");
           iter = processes_.erase(iter);
         }
         continue;
       } else {
-        logger.Log("Process is running", Debug);
+        logger.Log(Debug, "Process is running");
+        CheckWatchdog(iter->first, iter->second);
+        CheckIdle(iter->first, iter->second);
       }
     } else {
-      logger.Log("Process is set to terminate", Debug);
+      logger.Log(Debug, "Process is set to terminate");
+    }
+    ++iter;
+  }
+  pr_main_m_.unlock();
+  logger.Log(Debug, "Mutex unlocked");
+}
+
+void LauncherServer::Implementation::CheckWatchdog(
+    const std::string& bin_name, ProcessInfo& info) noexcept {
+  LServer l_server(LServer::Watchdog, logger_);
+  Logger& logger = l_server;
+  if (!info.config.watchdog_interval.has_value()) {
+    return;
+  }
+  auto now = std::chrono::system_clock::now();
+  if (notify_fd_ == -1) {  // NOTIFY_SOCKET is not passed, no heartbeats
+    if (!info.watchdog.has_value()) {
+      logger.Log(Warning, "No notification socket, watchdog of {} is off",
+                 bin_name);
+      info.watchdog = now;
+    }
+    return;
+  }
+  if (!info.watchdog.has_value()) {  // just taken by the main table
+    info.watchdog = now;
+    return;
+  }
+
+  if (!info.watchdog_term_sent.has_value()) {
+    if (now - info.watchdog.value() <= info.config.watchdog_interval.value()) {
+      return;
+    }
+    logger.Log(Warning, "No heartbeat from {} (pid {}) for {} ms. Sending "
+               "SIGTERM", bin_name, info.pid,
+               std::chrono::duration_cast<std::chrono::milliseconds>(
+                   now - info.watchdog.value())
+                   .count());
+    watchdog_timeouts_.fetch_add(1, std::memory_order_relaxed);
+    NotifySubscribers(WatchdogTimeout, bin_name, info.pid);
+    KillProcess(bin_name, info.pid, SIGTERM);
+    info.watchdog_term_sent = now;
+    return;
+  }
+  // the process is rerun by the main table when it has gone, so a hung one
+  // is killed after time_to_stop, or after one more interval if it is unset
+  if (now - info.watchdog_term_sent.value() >
+      info.config.time_to_stop.value_or(
+          info.config.watchdog_interval.value())) {
+    logger.Log(Warning, "Hung process {} (pid {}) ignores SIGTERM. Sending "
+               "SIGKILL", bin_name, info.pid);
+    KillProcess(bin_name, info.pid, SIGKILL);
+    NotifySubscribers(Killed, bin_name, SigKill);
+    info.watchdog_term_sent = now;  // SIGKILL is repeated until it has gone
+  }
+}
+
+void LauncherServer::Implementation::CheckIdle(const std::string& bin_name,
+                                               ProcessInfo& info) noexcept {
+  LServer l_server(LServer::Idle, logger_);
+  Logger& logger = l_server;
+  if (!info.config.idle_timeout.has_value() || !info.config.on_demand ||
+      info.config.listen_ports.empty()) {
+    return;
+  }
+  // workers are counted by the cgroup, otherwise only when waited
+  auto cpu_time = cgroup_root_.empty()
+                      ? ReadCpuTime(info.pid)
+                      : ReadCgroupCpuTime(GetCgroupPath(bin_name));
+  if (!cpu_time.has_value()) {
+    cpu_time = ReadCpuTime(info.pid);
+  }
+  if (!cpu_time.has_value()) {
+    return;
+  }
+  auto now = std::chrono::system_clock::now();
+  if (!info.active.has_value() || cpu_time.value() != info.cpu_time) {
+    info.cpu_time = cpu_time.value();
+    info.active = now;
+    return;
+  }
+  if (now - info.active.value() <= info.config.idle_timeout.value()) {
+    return;
+  }
+  // read once the cpu has been idle for the whole period
+  if (HasConnections(info.config.listen_ports)) {
+    logger.Log(Debug, "Process {} has connections", bin_name);
+    info.active = now;
+    return;
+  }
+
+  logger.Log(Info, "Process {} (pid {}) is idle. Stopping until the next "
+             "connection", bin_name, info.pid);
+  idle_stops_.fetch_add(1, std::memory_order_relaxed);
+  NotifySubscribers(Idle, bin_name, info.pid);
+  pr_to_term_m_.lock();
+  processes_to_terminate_.insert({bin_name, {.is_idle = true}});
+  pr_to_term_m_.unlock();
+}
+
+void LauncherServer::Implementation::PrCtrlRetiring() noexcept {
+  LServer l_server(LServer::PrCtrlRetiring, logger_);
+  Logger& logger = l_server;
+
+  std::lock_guard retiring_lock(retiring_m_);
+  for (auto iter = retiring_.begin(); iter != retiring_.end();) {
+    if (!iter->term_sent.has_value()) {  // new instance is starting
+      ++iter;
+      continue;
+    }
+    logger.Log(Info, "Processing old instance of {} (pid {})", iter->bin_name,
+               iter->info.pid);
+    if (!IsPidAvailable(iter->info.pid)) {
+      logger.Log(Info, "Old instance has terminated");
+      iter = retiring_.erase(iter);
+      continue;
+    }
+    if (!iter->info.config.time_to_stop.has_value()) {
+      logger.Log(Info, "Checking termination is not required");
+      iter = retiring_.erase(iter);
+      continue;
+    }
+    if (std::chrono::system_clock::now() - iter->term_sent.value() >
+        iter->info.config.time_to_stop.value()) {
+      logger.Log(Info, "Timer timeout. Sending SIGKILL");
+      KillProcess(iter->bin_name, iter->info.pid, SIGKILL);
+      iter = retiring_.erase(iter);
+      continue;
     }
     ++iter;
   }
+}
+RunStatus LauncherServer::Implementation::RollingRestart(
+    std::string&& bin_name, ProcessConfig&& process,
+    const Deadline& deadline) noexcept {
+  LServer l_server(LServer::RollingRestart, logger_);
+  Logger& logger = l_server;
+  logger.Log(Info, "Process: {}", bin_name);
+
+  logger.Log(Debug, "Locking main, run, term and retiring mutexes");
+  pr_main_m_.lock();
+  pr_to_run_m_.lock();
+  pr_to_term_m_.lock();
+  auto main_iter = processes_.find(bin_name);
+  if (main_iter == processes_.end() || processes_to_run_.contains(bin_name) ||
+      processes_to_terminate_.contains(bin_name)) {
+    pr_to_term_m_.unlock();
+    pr_to_run_m_.unlock();
+    pr_main_m_.unlock();
+    logger.Log(Info, "Process is not running or is being stopped");
+    return RunFailed;
+  }
+  // old instance keeps serving, but is not controlled by the main table
+  int old_pid = main_iter->second.pid;
+  retiring_m_.lock();
+  retiring_.push_back(
+      {.bin_name = bin_name, .info = std::move(main_iter->second)});
+  retiring_m_.unlock();
+  processes_.erase(main_iter);
+  pr_to_term_m_.unlock();
+  pr_to_run_m_.unlock();
+  pr_main_m_.unlock();
+  logger.Log(Debug, "Mutexes unlocked. Old instance (pid {}) is retiring",
+             old_pid);
+
+  auto status =
+      RunProcess(std::string(bin_name), std::move(process), true, deadline);
+  logger.Log(Info, "New instance is run with {}", status);
+
+  pr_main_m_.lock();
+  pr_to_run_m_.lock();
+  // a registered instance still waiting for readiness is not run: the old
+  // one keeps serving and the new launch is cancelled
+  bool is_new_run = status == RunSucceeded || processes_.contains(bin_name);
+  auto run_iter = processes_to_run_.find(bin_name);
+  if (!is_new_run && run_iter != processes_to_run_.end()) {
+    logger.Log(Info, "Cancelling launch of the new instance");
+    if (run_iter->second.info.pid != 0) {
+      KillStarting(bin_name, run_iter->second.info.pid);
+      NotifySubscribers(Killed, bin_name, SigKill);
+    }
+    ProcessChangeSend(RunFailed, run_iter->second.run_semaphore,
+                      run_iter->second.run_status, logger);
+    processes_to_run_.erase(run_iter);
+  }
+
+  retiring_m_.lock();
+  auto old = std::find_if(
+      retiring_.begin(), retiring_.end(), [old_pid](const Retiring& retiring) {
+        return retiring.info.pid == old_pid && !retiring.term_sent.has_value();
+      });
+  if (old == retiring_.end()) {  // taken by the shutdown
+    logger.Log(Info, "Old instance has been stopped");
+  } else if (is_new_run) {
+    logger.Log(Info, "Stopping old instance");
+    KillProcess(bin_name, old_pid, SIGTERM);
+    old->term_sent = std::chrono::system_clock::now();
+  } else {
+    logger.Log(Warning, "New instance is not run. Keeping old one");
+    processes_.insert({bin_name, std::move(old->info)});
+    retiring_.erase(old);
+  }
+  retiring_m_.unlock();
+  pr_to_run_m_.unlock();
+  pr_main_m_.unlock();
+
+  if (!is_new_run) {
+    return status == RunSucceeded ? RunFailed : status;
+  }
+  return RunSucceeded;
+}
+std::optional<std::vector<int>>
+LauncherServer::Implementation::GetListenFds(
+    const std::string& bin_name,
+    const std::vector<uint16_t>& ports) noexcept {
+  LServer l_server(LServer::Listeners, logger_);
+  Logger& logger = l_server;
+
+  std::lock_guard listeners_lock(listeners_m_);
+  auto& listeners = listeners_[bin_name];
+  if (listeners.ports == ports && listeners.fds.size() == ports.size()) {
+    logger.Log(Debug, "Reusing {} sockets of {}", ports.size(), bin_name);
+    return listeners.fds;
+  }
+
+  logger.Log(Info, "Opening {} sockets of {}", ports.size(), bin_name);
+  for (int fd : listeners.fds) {
+    close(fd);
+  }
+  listeners.ports = ports;
+  listeners.fds.clear();
+  for (uint16_t port : ports) {
+    int fd = OpenListener(port);
+    if (fd == -1) {
+      // descriptors are matched to ports by order, so all or nothing
+      logger.Log(Warning, "Cannot listen port {}: {}", port, strerror(errno));
+      for (int opened : listeners.fds) {
+        close(opened);
+      }
+      listeners_.erase(bin_name);
+      return {};
+    }
+    listeners.fds.push_back(fd);
+  }
+  return listeners.fds;
+}
+void LauncherServer::Implementation::CloseUnusedListeners() noexcept {
+  LServer l_server(LServer::Listeners, logger_);
+  Logger& logger = l_server;
+
+  pr_main_m_.lock();
+  pr_to_run_m_.lock();
+  retiring_m_.lock();
+  listeners_m_.lock();
+  for (auto iter = listeners_.begin(); iter != listeners_.end();) {
+    const auto& bin_name = iter->first;
+    bool is_used =
+        processes_.contains(bin_name) ||
+        processes_to_run_.contains(bin_name) ||
+        std::any_of(retiring_.begin(), retiring_.end(),
+                    [&bin_name](const Retiring& retiring) {
+                      return retiring.bin_name == bin_name &&
+                             !retiring.term_sent.has_value();
+                    });
+    if (is_used) {
+      ++iter;
+      continue;
+    }
+    logger.Log(Info, "Process {} is stopped, closing its sockets", bin_name);
+    for (int fd : iter->second.fds) {
+      close(fd);
+    }
+    iter = listeners_.erase(iter);
+  }
+  listeners_m_.unlock();
+  retiring_m_.unlock();
+  pr_to_run_m_.unlock();
+  pr_main_m_.unlock();
+}
+void LauncherServer::Implementation::RemoveUnusedCgroups() noexcept {
+  if (cgroup_root_.empty()) {
+    return;
+  }
+  LServer l_server(LServer::Cgroups, logger_);
+  Logger& logger = l_server;
+
+  pr_main_m_.lock();
+  pr_to_run_m_.lock();
+  pr_to_term_m_.lock();
+  retiring_m_.lock();
+  cgroups_m_.lock();
+  for (auto iter = cgroups_.begin(); iter != cgroups_.end();) {
+    const auto& bin_name = *iter;
+    bool is_used =
+        processes_.contains(bin_name) ||
+        processes_to_run_.contains(bin_name) ||
+        processes_to_terminate_.contains(bin_name) ||
+        std::any_of(retiring_.begin(), retiring_.end(),
+                    [&bin_name](const Retiring& retiring) {
+                      return retiring.bin_name == bin_name;
+                    });
+    auto cgroup = GetCgroupPath(bin_name);
+    // EBUSY while workers of the process are still alive in it
+    if (is_used || (rmdir(cgroup.c_str()) != 0 && errno != ENOENT)) {
+      ++iter;
+      continue;
+    }
+    logger.Log(Info, "Process {} is stopped, cgroup {} is removed", bin_name,
+               cgroup);
+    iter = cgroups_.erase(iter);
+  }
+  cgroups_m_.unlock();
+  retiring_m_.unlock();
+  pr_to_term_m_.unlock();
+  pr_to_run_m_.unlock();
   pr_main_m_.unlock();
-  logger.Log("Mutex unlocked", Debug);
 }
 
-bool LauncherServer::Implementation::RunProcess(std::string&& bin_name,
-                                                LNCR::ProcessConfig&& process,
-                                                bool wait_for_run) noexcept {
+RunStatus LauncherServer::Implementation::RunProcess(
+    std::string&& bin_name, LNCR::ProcessConfig&& process, bool wait_for_run,
+    const Deadline& deadline, TraceContext trace) noexcept {
   LServer l_server(LServer::RunProcess, logger_);
   Logger& logger = l_server;
-  logger.Log("Process: " + bin_name, Info);
+  logger.Log(Info, "Process: {}", bin_name);
+
+  if (trace.trace_id == 0) {
+    trace.trace_id = NewTraceId();
+  }
+  logger.Log(Debug, "Trace id: {}", trace.trace_id);
 
-  logger.Log("Locking main and run mutexes", Debug);
+  logger.Log(Debug, "Locking main and run mutexes");
   pr_main_m_.lock();
   pr_to_run_m_.lock();
-  logger.Log("Mutexes main and run locked", Debug);
+  logger.Log(Debug, "Mutexes main and run locked");
 
   bool is_running =
       processes_to_run_.contains(bin_name) || processes_.contains(bin_name);
 
   pr_main_m_.unlock();
-  logger.Log("Mutex main unlocked", Debug);
+  logger.Log(Debug, "Mutex main unlocked");
 
   if (is_running) {
-    logger.Log("Process is already running", Info);
+    logger.Log(Info, "Process is already running");
 
     pr_to_run_m_.unlock();
-    logger.Log("Mutex run unlocked", Debug);
-    return false;
+    logger.Log(Debug, "Mutex run unlocked");
+    return RunFailed;
   }
 
-  logger.Log("Locking load mutex", Debug);
-  load_conf_m_.lock();
-  logger.Log("Mutex load locked", Debug);
-
-  if (process.launch_on_boot) {
-    logger.Log("Process will be launched on boot", Info);
+  UpdateBootConfig(bin_name, process, logger);
 
-    if (!load_config_.contains(bin_name)) {
-      logger.Log("Inserting process into loading table", Debug);
-      load_config_.insert({bin_name, process});
-    } else {
-      load_config_[bin_name] = process;
-      logger.Log("Load table already contains process", Debug);
+  // sockets of an on demand process are its run
+  bool is_on_demand = process.on_demand && !process.listen_ports.empty();
+  if (is_on_demand) {
+    logger.Log(Info, "Process is spawned on demand, opening its sockets");
+    if (!GetListenFds(bin_name, process.listen_ports).has_value()) {
+      pr_to_run_m_.unlock();
+      logger.Log(Warning, "Cannot open sockets. Mutex run unlocked");
+      return RunFailed;
     }
-  } else {
-    logger.Log(
-        "Process will not be launched on boot. Trying to erase out of date "
-        "content",
-        Info);
-    load_config_.erase(bin_name);
+    wait_for_run = false;
   }
 
-  load_conf_m_.unlock();
-  logger.Log("Mutex load unlocked", Debug);
-
   std::binary_semaphore* semaphore = nullptr;
   int* run_status = nullptr;
   if (wait_for_run) {
@@ -299,57 +1049,129 @@ bool LauncherServer::Implementation::RunProcess(std::string&& bin_name,
   }
   Runner runner = {.info = {.config = std::move(process)},
                    .run_status = run_status,
-                   .run_semaphore = semaphore};
-  logger.Log("Inserting process into run table", Debug);
+                   .run_semaphore = semaphore,
+                   .trace = trace};
+  if (is_on_demand) {
+    runner.armed = runner.queued;
+  }
+  logger.Log(Debug, "Inserting process into run table");
   auto inserted =
       processes_to_run_.insert({std::move(bin_name), std::move(runner)});
+  if (inserted.second) {
+    NotifySubscribers(Launching, inserted.first->first, 0);
+  }
 
   pr_to_run_m_.unlock();
-  logger.Log("Mutex run unlocked", Debug);
+  logger.Log(Debug, "Mutex run unlocked");
 
   if (!inserted.second) {
     if (wait_for_run) {
       delete semaphore;
       delete run_status;
     }
-    logger.Log("Run table has already contained process. Term exec", Info);
-    return false;
+    logger.Log(Info, "Run table has already contained process. Term exec");
+    return RunFailed;
   } else {
-    logger.Log("Process inserted to run table", Debug);
+    logger.Log(Debug, "Process inserted to run table");
   }
 
-  bool result = true;
+  RunStatus result = RunSucceeded;
   if (wait_for_run) {
-    logger.Log("Runner is waiting for running", Info);
-    semaphore->acquire();
-    result = *run_status;
+    logger.Log(Info, "Runner is waiting for running");
+    if (WaitForChange(semaphore, deadline)) {
+      result = static_cast<RunStatus>(*run_status);
+      delete semaphore;
+      delete run_status;
+      logger.Log(Info, "Process is run with {}", result);
+      return result;
+    }
+
+    logger.Log(Debug, "Deadline exceeded. Locking run mutex to detach waiter");
+    pr_to_run_m_.lock();
+    bool is_detached = false;
+    for (auto& [name, runner] : processes_to_run_) {
+      if (runner.run_semaphore == semaphore) {
+        runner.run_semaphore = nullptr;
+        runner.run_status = nullptr;
+        is_detached = true;
+        break;
+      }
+    }
+    pr_to_run_m_.unlock();
+    logger.Log(Debug, "Run mutex unlocked");
+
+    if (is_detached) {
+      logger.Log(Warning, "Waiter detached. Process is not run in time");
+      result = RunTimeout;
+    } else {
+      logger.Log(Info, "Result has been sent while detaching, getting it");
+      semaphore->acquire();
+      result = static_cast<RunStatus>(*run_status);
+    }
     delete semaphore;
     delete run_status;
-    logger.Log("Process is running", Info);
   } else {
-    logger.Log("Runner is not waiting for running", Info);
+    logger.Log(Info, "Runner is not waiting for running");
   }
   return result;
 }
+void LauncherServer::Implementation::UpdateBootConfig(
+    const std::string& bin_name, const ProcessConfig& process,
+    Logger& logger) noexcept {
+  logger.Log(Debug, "Locking load mutex");
+  load_conf_m_.lock();
+  logger.Log(Debug, "Mutex load locked");
+
+  if (process.launch_on_boot) {
+    logger.Log(Info, "Process will be launched on boot");
+
+    if (!load_config_.contains(bin_name)) {
+      logger.Log(Debug, "Inserting process into loading table");
+      load_config_.insert({bin_name, process});
+      AppendJournal(SerializeJournalSet(bin_name, process));
+    } else if (!(load_config_[bin_name] == process)) {
+      load_config_[bin_name] = process;
+      AppendJournal(SerializeJournalSet(bin_name, process));
+      logger.Log(Debug, "Load table already contains process. Updated");
+    } else {
+      logger.Log(Debug, "Load table already contains process");
+    }
+    NotifySubscribers(LoadConfigChanged, bin_name, true);
+  } else {
+    logger.Log(Info,
+               "Process will not be launched on boot. Trying to erase out of "
+               "date content");
+    if (load_config_.erase(bin_name) == 1) {
+      AppendJournal(SerializeJournalErase(bin_name));
+      NotifySubscribers(LoadConfigChanged, bin_name, false);
+    }
+  }
+
+  load_conf_m_.unlock();
+  logger.Log(Debug, "Mutex load unlocked");
+}
 TermStatus LauncherServer::Implementation::StopProcess(
-    const std::string& bin_name, bool wait_for_term) noexcept {
+    const std::string& bin_name, bool wait_for_term,
+    const Deadline& deadline) noexcept {
   LServer l_server(LServer::StopProcess, logger_);
   Logger& logger = l_server;
-  logger.Log("Process: " + bin_name, Info);
+  logger.Log(Info, "Process: {}", bin_name);
 
-  logger.Log("Locking load mutex", Debug);
+  logger.Log(Debug, "Locking load mutex");
   load_conf_m_.lock();
-  logger.Log("Load mutex locked", Debug);
+  logger.Log(Debug, "Load mutex locked");
 
-  logger.Log("Trying to erase process from load table", Debug);
+  logger.Log(Debug, "Trying to erase process from load table");
   if (load_config_.erase(bin_name) == 1) {
-    logger.Log("Process erased from load table", Info);
+    logger.Log(Info, "Process erased from load table");
+    AppendJournal(SerializeJournalErase(bin_name));
+    NotifySubscribers(LoadConfigChanged, bin_name, false);
   } else {
-    logger.Log("Table was not contain this process", Debug);
+    logger.Log(Debug, "Table was not contain this process");
   }
 
   load_conf_m_.unlock();
-  logger.Log("Load mutex unlocked", Debug);
+  logger.Log(Debug, "Load mutex unlocked");
 
   std::binary_semaphore* semaphore = nullptr;
   int* term_status = nullptr;
@@ -359,84 +1181,448 @@ TermStatus LauncherServer::Implementation::StopProcess(
   }
   Stopper stopper = {.term_status = term_status, .term_semaphore = semaphore};
 
-  logger.Log("Locking mutex", Debug);
+  logger.Log(Debug, "Locking mutex");
   pr_to_term_m_.lock();
-  logger.Log("Mutex locked", Debug);
+  logger.Log(Debug, "Mutex locked");
 
   auto iter =
       processes_to_terminate_.insert({std::move(bin_name), std::move(stopper)});
+  if (!iter.second && iter.first->second.is_idle) {
+    logger.Log(Info, "Process is being stopped as idle. Taking the stop over");
+    iter.first->second.is_idle = false;
+    iter.first->second.term_status = term_status;
+    iter.first->second.term_semaphore = semaphore;
+    iter.second = true;
+  }
 
   pr_to_term_m_.unlock();
-  logger.Log("Mutex unlocked", Debug);
+  logger.Log(Debug, "Mutex unlocked");
 
   if (!iter.second) {
     if (wait_for_term) {
       delete semaphore;
       delete term_status;
     }
-    logger.Log("Term table has already contained process. Term exec", Info);
+    logger.Log(Info, "Term table has already contained process. Term exec");
     return AlreadyTerminating;
   } else {
-    logger.Log("Process inserted to term table", Debug);
+    logger.Log(Debug, "Process inserted to term table");
   }
 
   TermStatus result = NoCheck;
 
   if (wait_for_term) {
-    logger.Log("Terminator is waiting for terminating", Info);
-    semaphore->acquire();
-    result = static_cast<TermStatus>(*term_status);
+    logger.Log(Info, "Terminator is waiting for terminating");
+    if (WaitForChange(semaphore, deadline)) {
+      result = static_cast<TermStatus>(*term_status);
+      delete semaphore;
+      delete term_status;
+      logger.Log(Info, "Process is terminated with {}", result);
+      return result;
+    }
 
+    logger.Log(Debug, "Deadline exceeded. Locking term mutex to detach waiter");
+    pr_to_term_m_.lock();
+    bool is_detached = false;
+    for (auto& [name, stopper] : processes_to_terminate_) {
+      if (stopper.term_semaphore == semaphore) {
+        stopper.term_semaphore = nullptr;
+        stopper.term_status = nullptr;
+        is_detached = true;
+        break;
+      }
+    }
+    pr_to_term_m_.unlock();
+    logger.Log(Debug, "Term mutex unlocked");
+
+    if (is_detached) {
+      logger.Log(Warning, "Waiter detached. Process is not terminated in time");
+      result = TermTimeout;
+    } else {
+      logger.Log(Info, "Result has been sent while detaching, getting it");
+      semaphore->acquire();
+      result = static_cast<TermStatus>(*term_status);
+    }
     delete semaphore;
     delete term_status;
-    logger.Log("Process is terminated with " + std::to_string(result), Info);
   } else {
-    logger.Log("Terminator is not waiting for terminating", Info);
+    logger.Log(Info, "Terminator is not waiting for terminating");
   }
   return result;
 }
 
-void LauncherServer::Implementation::SendRun(
-    const std::string& name, const LNCR::ProcessConfig& config) noexcept {
+int LauncherServer::Implementation::SendRun(
+    const std::string& name, const LNCR::ProcessConfig& config,
+    uint64_t trace_id) noexcept {
   LServer l_server(LServer::SentRun, logger_);
   Logger& logger = l_server;
-  logger.Log("Process: " + name, Debug);
+  logger.Log(Debug, "Process: {}", name);
+  auto start = std::chrono::system_clock::now();
+
+  // everything is prepared before fork: only async-signal-safe calls are
+  // allowed in the child of a multithreaded process
+  std::vector<std::string> arguments = {agent_binary_, std::to_string(port_),
+                                        name};
+  arguments.insert(arguments.end(), config.args.begin(), config.args.end());
+  std::vector<char*> argv;
+  for (auto& argument : arguments) {
+    argv.push_back(argument.data());
+  }
+  argv.push_back(nullptr);
+
+  std::vector<int> listen_fds;
+  if (!config.listen_ports.empty()) {
+    auto opened = GetListenFds(name, config.listen_ports);
+    if (!opened.has_value()) {
+      logger.Log(Warning, "Cannot open sockets of {}, not launching", name);
+      return -1;
+    }
+    listen_fds = std::move(opened.value());
+  }
+  std::vector<int> moved_fds(listen_fds.size());
+  int first_free_fd = 3 + listen_fds.size();
+
+  std::string trace_env =
+      std::string(kTraceIdEnv) + "=" + std::to_string(trace_id);
+  std::string listen_env = "LISTEN_FDS=" + std::to_string(listen_fds.size());
+  std::string notify_env = "NOTIFY_SOCKET=" + notify_path_;
+  std::string watchdog_env = "WATCHDOG_USEC=";
+  if (config.watchdog_interval.has_value()) {
+    watchdog_env += std::to_string(
+        std::chrono::microseconds(config.watchdog_interval.value()).count());
+  }
+  std::vector<char*> envp;
+  for (char** env = environ; *env != nullptr; ++env) {
+    if (strncmp(*env, "LISTEN_", 7) != 0 &&  // not the server ones
+        strncmp(*env, "WATCHDOG_", 9) != 0 &&
+        strncmp(*env, "NOTIFY_SOCKET=", 14) != 0) {
+      envp.push_back(*env);
+    }
+  }
+  if (!listen_fds.empty()) {
+    envp.push_back(listen_env.data());
+  }
+  if (notify_fd_ != -1) {
+    envp.push_back(notify_env.data());
+    if (config.watchdog_interval.has_value()) {
+      envp.push_back(watchdog_env.data());
+    }
+  }
+
+  std::string cgroup_procs;
+  if (!cgroup_root_.empty()) {
+    auto cgroup = GetCgroupPath(name);
+    if (mkdir(cgroup.c_str(), 0755) != 0 && errno != EEXIST) {
+      logger.Log(Warning, "Cannot create cgroup {}: {}", cgroup,
+                 strerror(errno));
+    } else {
+      cgroup_procs = cgroup + "/cgroup.procs";
+      std::lock_guard cgroups_lock(cgroups_m_);
+      cgroups_.insert(name);
+    }
+  }
 
-  std::string launch_conf =
-      agent_binary_ + " " + std::to_string(port_) + " " + name + " ";
-  for (const auto& arg : config.args) {
-    launch_conf += arg + " ";
+  // the spawner execs the process itself, the agent handshake is skipped
+  std::vector<std::string> spawn_args = {name};
+  spawn_args.insert(spawn_args.end(), config.args.begin(), config.args.end());
+  auto pid = Spawn(cgroup_procs, spawn_args, envp, listen_fds, logger);
+  if (pid.has_value()) {
+    launches_.fetch_add(1, std::memory_order_relaxed);
+    trace_.Record(trace_id, "spawner", name, start,
+                  std::chrono::system_clock::now());
+    return pid.value();
   }
-  launch_conf += "&";
 
-  system(launch_conf.c_str());
-  logger.Log("Agent launched", Debug);
+  envp.push_back(trace_env.data());
+  envp.push_back(nullptr);
+
+  // the intermediate child exits at once, so the agent is reparented to
+  // init and never becomes a zombie of the server
+  pid_t child = fork();
+  if (child == 0) {
+    if (fork() != 0) {
+      _exit(0);
+    }
+    setsid();  // own session and process group, pgid == pid
+    if (!cgroup_procs.empty()) {
+      int fd = open(cgroup_procs.c_str(), O_WRONLY | O_CLOEXEC);
+      if (fd != -1) {
+        write(fd, "0", 1);
+        close(fd);
+      }
+    }
+    // listening sockets to 3, 4, ... moving them above the targets first
+    for (size_t i = 0; i < listen_fds.size(); ++i) {
+      moved_fds[i] = fcntl(listen_fds[i], F_DUPFD_CLOEXEC, first_free_fd);
+    }
+    for (size_t i = 0; i < moved_fds.size(); ++i) {
+      dup2(moved_fds[i], 3 + i);
+    }
+#ifdef SYS_close_range
+    syscall(SYS_close_range, first_free_fd, ~0u, 0);  // server sockets, files
+#endif
+    execvpe(argv[0], argv.data(), envp.data());
+    _exit(127);
+  }
+  if (child == -1) {
+    logger.Log(Error, "Cannot fork: {}", strerror(errno));
+    return 0;
+  }
+  waitpid(child, nullptr, 0);
+
+  launches_.fetch_add(1, std::memory_order_relaxed);
+  trace_.Record(trace_id, "spawn", name, start,
+                std::chrono::system_clock::now());
+  logger.Log(Debug, "Agent launched");
+  return 0;
+}
+void LauncherServer::Implementation::RegisterProcess(
+    const std::string& bin_name, Runner& runner, int pid,
+    Logger& logger) noexcept {
+  logger.Log(Info, "Process {} is run with pid {}", bin_name, pid);
+  runner.info.pid = pid;  // set pid : "successful run" flag
+  runner.registered = std::chrono::system_clock::now();
+  if (runner.last_run.has_value()) {
+    spawn_latency_.Record(runner.registered.value() -
+                          runner.last_run.value());
+  }
+  if (!runner.info.config.ready_timeout.has_value()) {
+    ProcessChangeSend(RunSucceeded, runner.run_semaphore, runner.run_status,
+                      logger);
+  } else {
+    logger.Log(Info, "Waiting for readiness notification");
+  }
+}
+
+bool LauncherServer::Implementation::Admit(
+    const std::string& bin_name, const ProcessConfig& config) noexcept {
+  auto now = std::chrono::system_clock::now();
+  auto refill = [now](TokenBucket& bucket, const RateLimit& limit) {
+    double refilled = limit.burst;
+    if (bucket.updated.has_value() && limit.interval.count() > 0) {
+      refilled = bucket.tokens + std::chrono::duration<double>(
+                                     now - bucket.updated.value()) /
+                                     limit.interval;
+    }
+    bucket.tokens = std::min<double>(refilled, limit.burst);
+    bucket.updated = now;
+  };
+
+  std::lock_guard admission_lock(admission_m_);
+  TokenBucket* process_bucket = nullptr;
+  if (config.launch_limit.has_value()) {
+    process_bucket = &process_buckets_[bin_name];
+    refill(*process_bucket, config.launch_limit.value());
+    if (process_bucket->tokens < 1) {
+      return false;
+    }
+  }
+  if (admission_.launch_limit.has_value()) {
+    refill(launch_bucket_, admission_.launch_limit.value());
+    if (launch_bucket_.tokens < 1) {
+      return false;
+    }
+    launch_bucket_.tokens -= 1;
+  }
+  if (process_bucket != nullptr) {
+    process_bucket->tokens -= 1;
+  }
+  return true;
+}
+bool LauncherServer::Implementation::IsUnderPressure(Logger& logger) noexcept {
+  admission_m_.lock();
+  auto memory_limit = admission_.memory_pressure;
+  auto cpu_limit = admission_.cpu_pressure;
+  admission_m_.unlock();
+
+  for (auto [resource, limit] :
+       {std::pair{"memory", memory_limit}, std::pair{"cpu", cpu_limit}}) {
+    if (!limit.has_value()) {
+      continue;
+    }
+    auto pressure = ReadPressure(resource);
+    if (pressure.has_value() && pressure.value() > limit.value()) {
+      logger.Log(Info, "{} pressure {} is above {}, launches wait", resource,
+                 pressure.value(), limit.value());
+      return true;
+    }
+  }
+  return false;
+}
+
+void LauncherServer::Implementation::StartSpawner() noexcept {
+  LServer l_server(LServer::Spawner, logger_);
+  Logger& logger = l_server;
+
+  int fds[2];
+  if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, fds) != 0) {
+    logger.Log(Warning, "Cannot create spawner socket: {}", strerror(errno));
+    spawner_failed_ = std::chrono::system_clock::now();
+    return;
+  }
+  std::string binary = agent_binary_;
+  std::string spawner_arg = kSpawnerArg;
+  char* argv[] = {binary.data(), spawner_arg.data(), nullptr};
+  pid_t pid = fork();
+  if (pid == 0) {
+    if (fds[1] == kSpawnerFd) {
+      fcntl(kSpawnerFd, F_SETFD, 0);
+    } else {
+      dup2(fds[1], kSpawnerFd);  // clears close-on-exec
+    }
+#ifdef SYS_close_range
+    syscall(SYS_close_range, kSpawnerFd + 1, ~0u, 0);
+#endif
+    execvp(argv[0], argv);
+    _exit(127);
+  }
+  close(fds[1]);
+  if (pid == -1) {
+    logger.Log(Warning, "Cannot fork spawner: {}", strerror(errno));
+    close(fds[0]);
+    spawner_failed_ = std::chrono::system_clock::now();
+    return;
+  }
+  logger.Log(Info, "Spawner is started with pid {}", pid);
+  spawner_fd_ = fds[0];
+  spawner_pid_ = pid;
+  spawner_failed_.reset();
+}
+void LauncherServer::Implementation::StopSpawner() noexcept {
+  if (spawner_fd_ == -1) {
+    return;
+  }
+  close(spawner_fd_);  // spawner exits reading the end of stream
+  waitpid(spawner_pid_, nullptr, 0);
+  spawner_fd_ = -1;
+  spawner_pid_ = 0;
+}
+std::optional<int> LauncherServer::Implementation::Spawn(
+    const std::string& cgroup_procs, const std::vector<std::string>& args,
+    const std::vector<char*>& envp, const std::vector<int>& listen_fds,
+    Logger& logger) noexcept {
+  std::lock_guard spawner_lock(spawner_m_);
+  if (spawner_fd_ == -1) {
+    if (!spawner_failed_.has_value() ||
+        std::chrono::system_clock::now() - spawner_failed_.value() <
+            kSpawnerRetry) {
+      return {};
+    }
+    logger.Log(Info, "Restarting spawner");
+    StartSpawner();
+    if (spawner_fd_ == -1) {
+      return {};
+    }
+  }
+
+  SpawnHeader header = {.args_num = static_cast<uint32_t>(args.size()),
+                        .env_num = static_cast<uint32_t>(envp.size())};
+  std::string request(reinterpret_cast<const char*>(&header), sizeof(header));
+  request.append(cgroup_procs.c_str(), cgroup_procs.size() + 1);
+  for (const auto& arg : args) {
+    request.append(arg.c_str(), arg.size() + 1);
+  }
+  for (const char* env : envp) {
+    request.append(env, strlen(env) + 1);
+  }
+  if (request.size() > kSpawnRequestMax || listen_fds.size() > kSpawnFdsMax) {
+    logger.Log(Info, "Request is too big for spawner, running agent");
+    return {};
+  }
+
+  alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int) * kSpawnFdsMax)];
+  iovec data = {.iov_base = request.data(), .iov_len = request.size()};
+  msghdr message = {.msg_iov = &data, .msg_iovlen = 1};
+  if (!listen_fds.empty()) {
+    message.msg_control = control;
+    message.msg_controllen = CMSG_SPACE(sizeof(int) * listen_fds.size());
+    cmsghdr* fds_header = CMSG_FIRSTHDR(&message);
+    fds_header->cmsg_level = SOL_SOCKET;
+    fds_header->cmsg_type = SCM_RIGHTS;
+    fds_header->cmsg_len = CMSG_LEN(sizeof(int) * listen_fds.size());
+    std::memcpy(CMSG_DATA(fds_header), listen_fds.data(),
+                sizeof(int) * listen_fds.size());
+  }
+
+  SpawnReply reply;
+  pollfd answer = {.fd = spawner_fd_, .events = POLLIN};
+  if (sendmsg(spawner_fd_, &message, MSG_NOSIGNAL) !=
+          static_cast<ssize_t>(request.size()) ||
+      poll(&answer, 1, kSpawnTimeout.count()) != 1 ||
+      recv(spawner_fd_, &reply, sizeof(reply), 0) != sizeof(reply)) {
+    logger.Log(Warning, "Spawner is not responding. Running agent");
+    kill(spawner_pid_, SIGKILL);
+    StopSpawner();
+    spawner_failed_ = std::chrono::system_clock::now();
+    return {};
+  }
+  if (reply.error != 0) {
+    logger.Log(Warning, "Cannot exec {}: {}", args[0], strerror(reply.error));
+    return 0;
+  }
+  return reply.pid;
 }
 bool LauncherServer::Implementation::IsPidAvailable(int pid) const noexcept {
-  return kill(pid, 0) == 0;
+  // processes adopted from older servers may not lead their group
+  return kill(-pid, 0) == 0 || kill(pid, 0) == 0;
+}
+void LauncherServer::Implementation::KillProcess(const std::string& bin_name,
+                                                 int pid,
+                                                 int signal) const noexcept {
+  if (kill(-pid, signal) != 0) {
+    kill(pid, signal);
+  }
+  if (signal == SIGKILL && !cgroup_root_.empty()) {
+    int fd = open((GetCgroupPath(bin_name) + "/cgroup.kill").c_str(),
+                  O_WRONLY | O_CLOEXEC);
+    if (fd != -1) {
+      write(fd, "1", 1);
+      close(fd);
+    }
+  }
+}
+void LauncherServer::Implementation::KillStarting(const std::string& bin_name,
+                                                  int pid) noexcept {
+  retiring_m_.lock();
+  bool is_rolling = std::any_of(retiring_.begin(), retiring_.end(),
+                                [&bin_name](const Retiring& retiring) {
+                                  return retiring.bin_name == bin_name &&
+                                         !retiring.term_sent.has_value();
+                                });
+  retiring_m_.unlock();
+  if (is_rolling) {  // the old instance shares the cgroup
+    kill(-pid, SIGKILL);
+  } else {
+    KillProcess(bin_name, pid, SIGKILL);
+  }
+}
+std::string LauncherServer::Implementation::GetCgroupPath(
+    const std::string& bin_name) const {
+  std::string cgroup = bin_name;
+  std::replace(cgroup.begin(), cgroup.end(), '/', '_');
+  return cgroup_root_ + "/" + cgroup;
 }
 
 std::optional<int> LauncherServer::Implementation::GetPid(
     const std::string& bin_name) noexcept {
   LServer l_server(LServer::GetPid, logger_);
   Logger& logger = l_server;
-  logger.Log("Process: " + bin_name, Debug);
+  logger.Log(Debug, "Process: {}", bin_name);
 
-  logger.Log("Locking mutex", Debug);
+  logger.Log(Debug, "Locking mutex");
   pr_main_m_.lock();
-  logger.Log("Mutex locked", Debug);
+  logger.Log(Debug, "Mutex locked");
 
   if (!processes_.contains(bin_name)) {
     pr_main_m_.unlock();
-    logger.Log("Main table does not contain process, unlocking mutex", Debug);
+    logger.Log(Debug, "Main table does not contain process, unlocking mutex");
     return {};
   }
 
   int pid = processes_[bin_name].pid;
   pr_main_m_.unlock();
-  logger.Log("Main table contains process. PID: " + std::to_string(pid) +
-                 ". Unlocked mutex",
-             Debug);
+  logger.Log(Debug, "Main table contains process. PID: {}. Unlocked mutex",
+             pid);
 
   return pid;
 }
@@ -444,55 +1630,237 @@ bool LauncherServer::Implementation::IsRunning(
     const std::string& bin_name) noexcept {
   LServer l_server(LServer::IsRunning, logger_);
   Logger& logger = l_server;
-  logger.Log("Process: " + bin_name, Debug);
+  logger.Log(Debug, "Process: {}", bin_name);
 
-  logger.Log("Locking main and run mutexes", Debug);
+  logger.Log(Debug, "Locking main and run mutexes");
   pr_main_m_.lock();
   pr_to_run_m_.lock();
-  logger.Log("Locked main and run mutexes. Getting result", Debug);
+  logger.Log(Debug, "Locked main and run mutexes. Getting result");
   bool is_running =
       processes_.contains(bin_name) || processes_to_run_.contains(bin_name);
 
-  logger.Log("Result got: " + std::to_string(is_running), Debug);
+  logger.Log(Debug, "Result got: {}", is_running);
   pr_to_run_m_.unlock();
   pr_main_m_.unlock();
-  logger.Log("Unlocked run and main mutexes", Debug);
+  logger.Log(Debug, "Unlocked run and main mutexes");
 
   return is_running;
 }
+RunStatus LauncherServer::Implementation::RerunProcess(
+    std::string&& bin_name, bool wait_for_rerun,
+    const Deadline& deadline) noexcept {
+  LServer l_server(LServer::RerunProcess, logger_);
+  Logger& logger = l_server;
+  logger.Log(Debug, "Process: {}. Locking mutex", bin_name);
+
+  pr_main_m_.lock();
+  logger.Log(Debug, "Mutex locked");
+  if (!processes_.contains(bin_name)) {
+    pr_main_m_.unlock();
+    logger.Log(Info, "Main table does not contain process. Unlocked mutex");
+    return RunFailed;
+  }
+  ProcessConfig config = processes_[bin_name].config;
+  pr_main_m_.unlock();
+  if (config.rolling_restart) {
+    logger.Log(Debug, "Main table contains process. Rolling restart");
+    return RollingRestart(std::move(bin_name), std::move(config), deadline);
+  }
+  logger.Log(Debug,
+             "Main table contains process. Got config. Unlocked mutex. "
+             "Terminating");
+
+  auto term_status = StopProcess(bin_name, true, deadline);
+  if (term_status == TermTimeout || term_status == TermCancelled) {
+    logger.Log(Warning, "Process is not terminated: {}", term_status);
+    return term_status == TermTimeout ? RunTimeout : RunCancelled;
+  }
+  logger.Log(Debug, "Process terminated. Running process");
+  return RunProcess(std::move(bin_name), std::move(config), wait_for_rerun,
+                    deadline);
+}
+bool LauncherServer::Implementation::CancelWaits(
+    const std::string& bin_name) noexcept {
+  LServer l_server(LServer::CancelWaits, logger_);
+  Logger& logger = l_server;
+  logger.Log(Info, "Process: {}", bin_name);
+
+  bool is_cancelled = false;
+
+  logger.Log(Debug, "Locking run mutex");
+  pr_to_run_m_.lock();
+  logger.Log(Debug, "Mutex run locked");
+  auto run_iter = processes_to_run_.find(bin_name);
+  if (run_iter != processes_to_run_.end() &&
+      run_iter->second.run_semaphore != nullptr) {
+    logger.Log(Info, "Releasing run waiter");
+    ProcessChangeSend(RunCancelled, run_iter->second.run_semaphore,
+                      run_iter->second.run_status, logger);
+    is_cancelled = true;
+  }
+  pr_to_run_m_.unlock();
+  logger.Log(Debug, "Mutex run unlocked");
+
+  logger.Log(Debug, "Locking term mutex");
+  pr_to_term_m_.lock();
+  logger.Log(Debug, "Mutex term locked");
+  auto term_iter = processes_to_terminate_.find(bin_name);
+  if (term_iter != processes_to_terminate_.end() &&
+      term_iter->second.term_semaphore != nullptr) {
+    logger.Log(Info, "Releasing term waiter");
+    ProcessChangeSend(TermCancelled, term_iter->second.term_semaphore,
+                      term_iter->second.term_status, logger);
+    is_cancelled = true;
+  }
+  pr_to_term_m_.unlock();
+  logger.Log(Debug, "Mutex term unlocked");
+
+  return is_cancelled;
+}
+
+void LauncherServer::Implementation::NotifySubscribers(
+    ProcessEventType type, const std::string& bin_name, int value) noexcept {
+  LServer l_server(LServer::NotifySubscribers, logger_);
+  Logger& logger = l_server;
+  logger.Log(Debug, "Process: {}. Event: {}", bin_name, type);
+
+  logger.Log(Debug, "Locking subscribers mutex");
+  subscribers_m_.lock();
+  logger.Log(Debug, "Mutex locked");
+
+  if (subscribers_.empty()) {
+    subscribers_m_.unlock();
+    logger.Log(Debug, "No subscribers. Mutex unlocked");
+    return;
+  }
+
+  for (auto* subscriber : subscribers_) {
+    if (subscriber->events.size() >= kSubscriberQueueSize) {
+      logger.Log(Warning, "Subscriber queue is full, event is lost");
+      ++subscriber->lost;
+      continue;
+    }
+    subscriber->events.push_back(
+        {.type = type, .bin_name = bin_name, .value = value});
+  }
+
+  subscribers_m_.unlock();
+  logger.Log(Debug, "Event queued. Mutex unlocked");
+  subscribers_cv_.notify_all();
+}
+
+ServerStats LauncherServer::Implementation::GetStats() noexcept {
+  ServerStats stats;
+  stats.uptime = std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::steady_clock::now() - start_time_);
+
+  load_conf_m_.lock();
+  stats.load_config = load_config_.size();
+  load_conf_m_.unlock();
+  pr_main_m_.lock();
+  stats.running = processes_.size();
+  pr_main_m_.unlock();
+  pr_to_run_m_.lock();
+  stats.to_run = processes_to_run_.size();
+  pr_to_run_m_.unlock();
+  pr_to_term_m_.lock();
+  stats.to_terminate = processes_to_terminate_.size();
+  pr_to_term_m_.unlock();
+  clients_m_.lock();
+  stats.clients = clients_.size();
+  clients_m_.unlock();
+  subscribers_m_.lock();
+  stats.subscribers = subscribers_.size();
+  subscribers_m_.unlock();
+
+  stats.launches = launches_.load(std::memory_order_relaxed);
+  stats.restarts = restarts_.load(std::memory_order_relaxed);
+  stats.watchdog_timeouts =
+      watchdog_timeouts_.load(std::memory_order_relaxed);
+  stats.idle_stops = idle_stops_.load(std::memory_order_relaxed);
+  stats.throttled_launches =
+      throttled_launches_.load(std::memory_order_relaxed);
+  if (stats.uptime.count() != 0) {
+    stats.launches_per_second =
+        stats.launches * 1000.0 / static_cast<double>(stats.uptime.count());
+  }
+
+  stats.spawn_latency = spawn_latency_.GetStats();
+  stats.stop_latency = stop_latency_.GetStats();
+  stats.control_loop = control_loop_.GetStats();
+
+  stats.mutexes = {load_conf_m_.GetStats("load"),
+                   pr_main_m_.GetStats("main"),
+                   pr_to_run_m_.GetStats("run"),
+                   pr_to_term_m_.GetStats("term"),
+                   clients_m_.GetStats("clients")};
+  stats.actions = LServer::GetStats();
+  return stats;
+}
 
 /*------------------------- constructor / destructor -------------------------*/
 LauncherServer::LauncherServer(int port, const std::string& config_file,
                                const std::string& agent_binary,
-                               logging_foo logging_f) {
+                               logging_foo logging_f,
+                               const std::string& cgroup_root) {
   LServer l_server(LServer::Constructor, logging_f);
   Logger& logger = l_server;
-  logger.Log("Creating launcher server", Info);
+  logger.Log(Info, "Creating launcher server");
 
-  logger.Log("Init implementation var. Creating tcp-server", Debug);
+  logger.Log(Debug, "Init implementation var. Creating tcp-server");
   implementation_ = std::unique_ptr<Implementation>(
       new Implementation{.tcp_server_ = TCP::TcpServer(port, logging_f),
                          .agent_binary_ = agent_binary,
                          .config_file_ = config_file,
                          .port_ = port,
+                         .cgroup_root_ = cgroup_root,
                          .logger_ = logging_f});
-  logger.Log(
-      "TCP-server created. Implementation var inited. Getting load config",
-      Debug);
+  logger.Log(Debug,
+             "TCP-server created. Implementation var inited. Getting load "
+             "config");
   implementation_->GetConfig();
+  implementation_->StartSpawner();
+  // sd_notify accepts only absolute and abstract socket names
+  std::error_code error;
+  auto notify_path = std::filesystem::absolute(config_file, error).string();
+  if (error) {
+    notify_path = config_file;
+  }
+  notify_path += kNotifySuffix;
+  if (notify_path.size() >= sizeof(sockaddr_un::sun_path)) {
+    char abstract_path[40];
+    snprintf(abstract_path, sizeof(abstract_path), "%s%016zx",
+             kNotifyAbstractPrefix, std::hash<std::string>()(notify_path));
+    logger.Log(Warning, "Notification socket path {} is too long, using {}",
+               notify_path, abstract_path);
+    notify_path = abstract_path;
+  }
+  implementation_->notify_path_ = notify_path;
+  implementation_->notify_fd_ = OpenNotifySocket(notify_path);
+  if (implementation_->notify_fd_ == -1) {
+    logger.Log(Error,
+               "Cannot open notification socket {}: {}. Readiness and "
+               "watchdog notifications are not available",
+               notify_path, strerror(errno));
+  }
+  implementation_->AdoptProcesses();
   for (const auto& [bin_name, process] : implementation_->load_config_) {
+    if (implementation_->processes_.contains(bin_name)) {
+      logger.Log(Info, "Process {} is adopted, not launching", bin_name);
+      continue;
+    }
     auto c_bin_name = bin_name;
     auto c_process = process;
     implementation_->RunProcess(std::move(c_bin_name), std::move(c_process));
   }
-  logger.Log("Config got", Debug);
+  logger.Log(Debug, "Config got");
 
-  logger.Log("Creating threads", Debug);
+  logger.Log(Debug, "Creating threads");
   try {
     implementation_->accepter_ =
         std::thread(&Implementation::Accepter, implementation_.get());
   } catch (std::system_error& error) {
-    logger.Log("Cannot create accepter thread", Error);
+    logger.Log(Error, "Cannot create accepter thread");
     throw error;
   }
 
@@ -500,292 +1868,929 @@ LauncherServer::LauncherServer(int port, const std::string& config_file,
     implementation_->receiver_ =
         std::thread(&Implementation::Receiver, implementation_.get());
   } catch (std::system_error& error) {
-    logger.Log("Cannot create receiver thread", Error);
+    logger.Log(Error, "Cannot create receiver thread");
     throw error;
   }
   try {
     implementation_->process_ctrl_ =
         std::thread(&Implementation::ProcessCtrl, implementation_.get());
   } catch (std::system_error& error) {
-    logger.Log("Cannot create process control thread", Error);
+    logger.Log(Error, "Cannot create process control thread");
+    throw error;
+  }
+  try {
+    implementation_->notifier_ =
+        std::thread(&Implementation::Notifier, implementation_.get());
+  } catch (std::system_error& error) {
+    logger.Log(Error, "Cannot create notification thread");
+    throw error;
+  }
+  try {
+    implementation_->activator_ =
+        std::thread(&Implementation::Activator, implementation_.get());
+  } catch (std::system_error& error) {
+    logger.Log(Error, "Cannot create socket activation thread");
     throw error;
   }
 
-  logger.Log("Threads created", Debug);
-  logger.Log("Launcher server created", Info);
+  logger.Log(Debug, "Threads created");
+  logger.Log(Info, "Launcher server created");
 }
 
 LauncherServer::~LauncherServer() {
   LServer l_server(LServer::Destructor, implementation_->logger_);
   Logger& logger = l_server;
-  logger.Log("Deleting launcher server", Info);
+  logger.Log(Info, "Deleting launcher server");
+  Shutdown();
+  logger.Log(Info, "Server deleted");
+}
+
+std::vector<StopTiming> LauncherServer::Shutdown(const Deadline& deadline) {
+  LServer l_server(LServer::Shutdown, implementation_->logger_);
+  Logger& logger = l_server;
+  if (implementation_->is_shut_down_) {
+    logger.Log(Debug, "Server is already shut down");
+    return {};
+  }
+  implementation_->is_shut_down_ = true;
+  logger.Log(Info, "Shutting launcher server down");
+  auto stop_deadline =
+      deadline.value_or(std::chrono::system_clock::now() + kShutdownTimeout);
+
+  logger.Log(Debug, "Setting terminating flag");
+  implementation_->is_active_ = false;
+
+  logger.Log(Debug, "Joining receiver");
+  implementation_->receiver_.join();
+  logger.Log(Debug, "Receiver joined");
+
+  logger.Log(Debug, "Closing listener");
+  implementation_->tcp_server_.CloseListener();
+  logger.Log(Debug, "Joining accepter");
+  implementation_->accepter_.join();
+  logger.Log(Debug, "Accepter joined");
+  logger.Log(Debug, "Joining notifier");
+  implementation_->notifier_.join();
+  if (implementation_->notify_fd_ != -1) {
+    close(implementation_->notify_fd_);
+    if (implementation_->notify_path_[0] != '@') {
+      unlink(implementation_->notify_path_.c_str());
+    }
+  }
+  logger.Log(Debug, "Notifier joined");
+  logger.Log(Debug, "Joining activator");
+  implementation_->activator_.join();
+  logger.Log(Debug, "Activator joined");
+
+  logger.Log(Debug, "Stopping journaling. Locking mutex");
+  implementation_->load_conf_m_.lock();
+  implementation_->is_journaling_ = false;  // stops below keep boot config
+  implementation_->load_conf_m_.unlock();
+  logger.Log(Debug, "Mutex unlocked. Saving load config");
+  implementation_->CompactConfig(true);
+
+  if (implementation_->is_handover_) {
+    logger.Log(Info, "Handing processes over");
+    implementation_->SaveHandover();
+  }
+  auto timings = implementation_->StopAll(stop_deadline);
+  logger.Log(Debug, "Processes stopped. Joining main table");
+  implementation_->process_ctrl_.join();
+  implementation_->StopSpawner();
+  logger.Log(Debug, "Main table joined. Closing journal");
+  if (implementation_->journal_fd_ != -1) {
+    close(implementation_->journal_fd_);
+  }
+
+  logger.Log(Debug, "Deleting existing semaphores");
+  for (auto& [bin_name, runner] : implementation_->processes_to_run_) {
+    implementation_->ProcessChangeSend(RunFailed, runner.run_semaphore,
+                                       runner.run_status, logger);
+  }
+  for (auto& [bin_name, stopper] : implementation_->processes_to_terminate_) {
+    implementation_->ProcessChangeSend(TermError, stopper.term_semaphore,
+                                       stopper.term_status, logger);
+  }
+  logger.Log(Debug, "All semaphores deleted");
+
+  logger.Log(Debug, "Terminating clients");
+  for (auto& [connection, curr_communication, is_running, available] :
+       implementation_->clients_) {
+    if (connection.has_value()) {
+      logger.Log(Debug, "Client is running, closing connection");
+      try {
+        connection.value().StopClient();
+      } catch (std::exception& exception) {
+        logger.Log(Warning, "Multithreading tcp connection error");
+      }
+      if (curr_communication.has_value()) {
+        logger.Log(Debug, "Joining client thread");
+        curr_communication->join();
+        logger.Log(Debug, "Client thread joined");
+      } else {
+        logger.Log(Debug, "Client is not running");
+      }
+    }
+  }
+  logger.Log(Debug, "Clients terminated");
+  logger.Log(Info, "Server shut down");
+  return timings;
+}
+
+std::vector<ActionStats> LauncherServer::GetActionStats() const {
+  return LServer::GetStats();
+}
+ServerStats LauncherServer::GetStats() const {
+  return implementation_->GetStats();
+}
+std::string LauncherServer::GetTrace() const {
+  return implementation_->trace_.GetChromeTrace();
+}
+std::map<std::string, ApplyResult> LauncherServer::ReloadConfig() {
+  return implementation_->ReloadConfig();
+}
+std::map<std::string, ApplyResult> LauncherServer::ApplyDesiredState(
+    const std::map<std::string, ProcessConfig>& desired, size_t max_parallel,
+    const Deadline& deadline) {
+  return implementation_->ApplyDesiredState(desired, max_parallel, deadline);
+}
+void LauncherServer::EnableHandover() { implementation_->is_handover_ = true; }
+void LauncherServer::SetAdmissionControl(const AdmissionConfig& config) {
+  LServer l_server(LServer::Admission, implementation_->logger_);
+  Logger& logger = l_server;
+  for (auto [resource, limit] : {std::pair{"memory", config.memory_pressure},
+                                 std::pair{"cpu", config.cpu_pressure}}) {
+    if (limit.has_value() && !ReadPressure(resource).has_value()) {
+      logger.Log(Warning, "No {} pressure information (PSI), not gating",
+                 resource);
+    }
+  }
+  std::lock_guard admission_lock(implementation_->admission_m_);
+  implementation_->admission_ = config;
+  implementation_->launch_bucket_ = {};
+}
+
+/*---------------------------- boot configuration ----------------------------*/
+void LauncherServer::Implementation::GetConfig() noexcept {
+  LServer l_server(LServer::GetConfig, logger_);
+  Logger& logger = l_server;
+  logger.Log(Debug, "Getting load config");
+
+  if (!ReadConfigFile(config_file_, load_config_)) {
+    logger.Log(Warning, "Error while reading config file");
+    if (std::filesystem::exists(config_file_)) {  // keep it from compaction
+      logger.Log(Error, "Config file is damaged, moving it to {}{}",
+                 config_file_, kDamagedSuffix);
+      rename(config_file_.c_str(), (config_file_ + kDamagedSuffix).c_str());
+    }
+  } else {
+    logger.Log(Debug, "Config got: {} entries", load_config_.size());
+  }
+
+  logger.Log(Debug, "Replaying journal");
+  bool is_torn;
+  size_t replayed =
+      ReadJournalFile(config_file_ + kJournalSuffix, load_config_, is_torn);
+  if (is_torn) {
+    logger.Log(Warning, "Torn journal record ignored");
+  }
+  logger.Log(Debug, "Journal replayed: {} records", replayed);
+
+  logger.Log(Debug, "Opening journal");
+  journal_fd_ = open((config_file_ + kJournalSuffix).c_str(),
+                     O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+  if (journal_fd_ == -1) {
+    logger.Log(Warning, "Cannot open journal: {}", strerror(errno));
+  }
+  CompactConfig(true);
+}
+bool LauncherServer::Implementation::SaveConfig(
+    const BootConfig& load_config) const noexcept {
+  LServer l_server(LServer::SetConfig, logger_);
+  Logger& logger = l_server;
+  logger.Log(Debug, "Saving load config");
+
+  auto config = SerializeConfig(load_config);
+  logger.Log(Debug, "Config serialized: {} bytes", config.size());
+
+  if (!ReplaceFile(config_file_, config, logger)) {
+    return false;
+  }
+  logger.Log(Debug, "Config saved");
+  return true;
+}
+
+void LauncherServer::Implementation::AppendJournal(
+    const std::string& record) noexcept {
+  if (!is_journaling_) {
+    return;
+  }
+  journal_pending_ += record;
+  ++journal_records_;
+  ++load_config_version_;
+}
+void LauncherServer::Implementation::SyncJournal() noexcept {
+  LServer l_server(LServer::SyncJournal, logger_);
+  Logger& logger = l_server;
+
+  std::lock_guard journal_lock(journal_m_);
+  load_conf_m_.lock();
+  std::string records = std::move(journal_pending_);
+  journal_pending_.clear();
+  load_conf_m_.unlock();
+
+  if (records.empty()) {
+    logger.Log(Debug, "Nothing to sync");
+    return;
+  }
+  if (journal_fd_ == -1) {
+    logger.Log(Warning, "Journal is not opened, records are lost");
+    return;
+  }
+  // one write and one fdatasync for all changes of the tick
+  if (!WriteAll(journal_fd_, records) || fdatasync(journal_fd_) != 0) {
+    logger.Log(Error, "Error while writing journal: {}", strerror(errno));
+    return;
+  }
+  logger.Log(Debug, "Journal synced: {} bytes", records.size());
+}
+void LauncherServer::Implementation::CompactConfig(bool force) noexcept {
+  LServer l_server(LServer::CompactConfig, logger_);
+  Logger& logger = l_server;
+
+  std::lock_guard journal_lock(journal_m_);
+  load_conf_m_.lock();
+  if (load_config_version_ == snapshot_version_ ||
+      (!force && journal_records_ < kJournalCompactRecords)) {
+    load_conf_m_.unlock();
+    logger.Log(Debug, "Compaction is not required");
+    return;
+  }
+  auto load_config = load_config_;
+  uint64_t version = load_config_version_;
+  journal_records_ = 0;
+  load_conf_m_.unlock();
+
+  logger.Log(Info, "Compacting journal into config file");
+  if (!SaveConfig(load_config)) {
+    logger.Log(Warning, "Compaction failed, keeping journal");
+    return;
+  }
+  snapshot_version_ = version;
+  // pending records are older than the snapshot or newer ones; replaying
+  // them over the snapshot gives the same result
+  if (journal_fd_ != -1 && ftruncate(journal_fd_, 0) != 0) {
+    logger.Log(Warning, "Error while truncating journal: {}",
+               strerror(errno));
+  }
+  logger.Log(Debug, "Journal compacted");
+}
+
+std::map<std::string, ApplyResult>
+LauncherServer::Implementation::ReloadConfig() noexcept {
+  LServer l_server(LServer::ReloadConfig, logger_);
+  Logger& logger = l_server;
+  logger.Log(Info, "Reloading load config");
+
+  logger.Log(Debug, "Syncing journal");
+  SyncJournal();  // pending changes are the part of the current config
+
+  BootConfig desired;
+  if (!ReadConfigFile(config_file_, desired)) {
+    logger.Log(Warning, "Error while reading config file, nothing is changed");
+    return {};
+  }
+  bool is_torn;
+  size_t replayed =
+      ReadJournalFile(config_file_ + kJournalSuffix, desired, is_torn);
+  logger.Log(Debug, "Config read: {} entries, {} journal records",
+             desired.size(), replayed);
+
+  std::lock_guard apply_lock(apply_m_);
+  auto results =
+      ApplyDiff(DiffState(desired, true), kApplyParallel,
+                std::chrono::system_clock::now() + kReloadTimeout);
+  logger.Log(Debug, "Diff applied. Compacting config");
+  CompactConfig(true);
+  logger.Log(Info, "Load config reloaded");
+  return results;
+}
+
+/*--------------------------------- handover ---------------------------------*/
+void LauncherServer::Implementation::SaveHandover() noexcept {
+  LServer l_server(LServer::Handover, logger_);
+  Logger& logger = l_server;
+
+  logger.Log(Debug, "Locking main, run and term mutexes");
+  pr_main_m_.lock();
+  pr_to_run_m_.lock();
+  pr_to_term_m_.lock();
+  logger.Log(Debug, "Mutexes locked");
+
+  // processes being stopped are left to the stop
+  std::vector<HandoverEntry> entries;
+  auto add = [&](const std::string& bin_name, const ProcessInfo& info) {
+    if (info.pid == 0 || processes_to_terminate_.contains(bin_name)) {
+      return false;
+    }
+    auto start_time = ReadStartTime(info.pid);
+    if (!start_time.has_value()) {
+      logger.Log(Info, "Process {} has gone, not handing over", bin_name);
+      return false;
+    }
+    entries.push_back({.bin_name = bin_name,
+                       .config = info.config,
+                       .pid = info.pid,
+                       .start_time = start_time.value()});
+    return true;
+  };
+  for (auto iter = processes_.begin(); iter != processes_.end();) {
+    iter = add(iter->first, iter->second) ? processes_.erase(iter) : ++iter;
+  }
+  // registered, but not moved to the main table yet
+  for (auto iter = processes_to_run_.begin();
+       iter != processes_to_run_.end();) {
+    if (add(iter->first, iter->second.info)) {
+      ProcessChangeSend(RunSucceeded, iter->second.run_semaphore,
+                        iter->second.run_status, logger);
+      iter = processes_to_run_.erase(iter);
+    } else {
+      ++iter;
+    }
+  }
+
+  pr_to_term_m_.unlock();
+  pr_to_run_m_.unlock();
+  pr_main_m_.unlock();
+  logger.Log(Debug, "Mutexes unlocked. Saving {} processes", entries.size());
+
+  if (!ReplaceFile(config_file_ + kHandoverSuffix, SerializeHandover(entries),
+                   logger)) {
+    logger.Log(Error, "Handover is not saved, processes are left unmanaged");
+    return;
+  }
+  logger.Log(Info, "Handover saved: {} processes", entries.size());
+}
+void LauncherServer::Implementation::AdoptProcesses() noexcept {
+  LServer l_server(LServer::AdoptProcesses, logger_);
+  Logger& logger = l_server;
 
-  logger.Log("Setting terminating flag", Debug);
-  implementation_->is_active_ = false;
+  auto path = config_file_ + kHandoverSuffix;
+  std::vector<HandoverEntry> entries;
+  if (!ReadHandoverFile(path, entries)) {
+    if (std::filesystem::exists(path)) {
+      logger.Log(Error, "Handover file is damaged, nothing is adopted");
+      unlink(path.c_str());
+    }
+    return;
+  }
+  logger.Log(Info, "Adopting {} processes", entries.size());
 
-  logger.Log("Joining receiver", Debug);
-  implementation_->receiver_.join();
-  logger.Log("Receiver joined", Debug);
+  pr_main_m_.lock();
+  for (auto& entry : entries) {
+    if (ReadStartTime(entry.pid) != entry.start_time) {
+      logger.Log(Info, "Process {} (pid {}) has gone, not adopting",
+                 entry.bin_name, entry.pid);
+      continue;
+    }
+    logger.Log(Info, "Process {} (pid {}) adopted", entry.bin_name,
+               entry.pid);
+    if (!cgroup_root_.empty()) {  // created by the previous server
+      std::lock_guard cgroups_lock(cgroups_m_);
+      cgroups_.insert(entry.bin_name);
+    }
+    processes_.insert_or_assign(
+        entry.bin_name,
+        ProcessInfo{.config = std::move(entry.config), .pid = entry.pid});
+  }
+  pr_main_m_.unlock();
 
-  logger.Log("Closing listener", Debug);
-  implementation_->tcp_server_.CloseListener();
-  logger.Log("Joining accepter", Debug);
-  implementation_->accepter_.join();
-  logger.Log("Accepter joined", Debug);
+  // adopted processes are not adopted again by a later server
+  unlink(path.c_str());
+  logger.Log(Debug, "Handover file removed");
+}
 
-  logger.Log("Saving load config. Locking mutex", Debug);
-  implementation_->load_conf_m_.lock();
-  logger.Log("Mutex locked", Debug);
-  implementation_->SaveConfig();
-  implementation_->load_conf_m_.unlock();
-  logger.Log("Mutex unlocked", Debug);
+/*--------------------------------- shutdown ---------------------------------*/
+std::vector<StopTiming> LauncherServer::Implementation::StopAll(
+    std::chrono::time_point<std::chrono::system_clock> deadline) noexcept {
+  LServer l_server(LServer::StopAll, logger_);
+  Logger& logger = l_server;
 
-  for (const auto& [bin_name, process] : implementation_->processes_) {
-    implementation_->StopProcess(bin_name, false);
+  struct Stopping {
+    StopTiming timing;
+    ProcessConfig config;
+    Stopper stopper = {};
+    int pid_fd = -1;
+    std::chrono::time_point<std::chrono::system_clock> kill_at;
+    bool is_done = false;
+  };
+  std::vector<Stopping> stopping;
+
+  logger.Log(Debug, "Locking main, run and term mutexes");
+  pr_main_m_.lock();
+  pr_to_run_m_.lock();
+  pr_to_term_m_.lock();
+  logger.Log(Debug, "Mutexes locked. Taking processes from tables");
+  auto take = [&](const std::string& bin_name, ProcessInfo&& info) {
+    Stopping process = {.timing = {.bin_name = bin_name, .pid = info.pid},
+                        .config = std::move(info.config)};
+    auto term_iter = processes_to_terminate_.find(bin_name);
+    if (term_iter != processes_to_terminate_.end()) {
+      process.stopper = term_iter->second;
+      processes_to_terminate_.erase(term_iter);
+    }
+    stopping.push_back(std::move(process));
+  };
+  for (auto& [bin_name, info] : processes_) {
+    take(bin_name, std::move(info));
   }
-  logger.Log("Load config saved. Joining main table", Debug);
-  implementation_->process_ctrl_.join();
-  logger.Log("Main table joined", Debug);
-
-  logger.Log("Deleting existing semaphores", Debug);
-  for (auto& [bin_name, runner] : implementation_->processes_to_run_) {
-    implementation_->ProcessChangeSend(false, runner.run_semaphore,
-                                       runner.run_status, logger);
+  processes_.clear();
+  // registered, but not moved to the main table yet
+  for (auto iter = processes_to_run_.begin();
+       iter != processes_to_run_.end();) {
+    if (iter->second.info.pid == 0) {
+      ++iter;
+      continue;
+    }
+    ProcessChangeSend(RunSucceeded, iter->second.run_semaphore,
+                      iter->second.run_status, logger);
+    take(iter->first, std::move(iter->second.info));
+    iter = processes_to_run_.erase(iter);
   }
-  for (auto& [bin_name, stopper] : implementation_->processes_to_terminate_) {
-    implementation_->ProcessChangeSend(TermError, stopper.term_semaphore,
-                                       stopper.term_status, logger);
+  retiring_m_.lock();
+  for (auto& retiring : retiring_) {
+    take(retiring.bin_name, std::move(retiring.info));
+  }
+  retiring_.clear();
+  retiring_m_.unlock();
+  pr_to_term_m_.unlock();
+  pr_to_run_m_.unlock();
+  pr_main_m_.unlock();
+  logger.Log(Info, "Mutexes unlocked. Stopping {} processes",
+             stopping.size());
+
+  auto start = std::chrono::system_clock::now();
+  auto finish = [&](Stopping& process, TermStatus status) {
+    auto now = std::chrono::system_clock::now();
+    process.is_done = true;
+    process.timing.status = status;
+    process.timing.duration =
+        std::chrono::duration_cast<std::chrono::milliseconds>(now - start);
+    if (process.pid_fd != -1) {
+      close(process.pid_fd);
+    }
+    stop_latency_.Record(now - process.stopper.requested);
+    NotifySubscribers(Killed, process.timing.bin_name, status);
+    ProcessChangeSend(status, process.stopper.term_semaphore,
+                      process.stopper.term_status, logger);
+    logger.Log(Info, "Process {} (pid {}) stopped with {} in {} ms",
+               process.timing.bin_name, process.timing.pid, status,
+               process.timing.duration.count());
+  };
+
+  // signal everything first, exits are awaited together
+  for (auto& process : stopping) {
+    process.pid_fd = OpenPidFd(process.timing.pid);
+    if (!IsPidAvailable(process.timing.pid)) {
+      finish(process, SigTerm);  // has already gone
+      continue;
+    }
+    KillProcess(process.timing.bin_name, process.timing.pid, SIGTERM);
+    process.kill_at = deadline;  // without time_to_stop killed at deadline
+    if (process.config.time_to_stop.has_value()) {
+      process.kill_at =
+          std::min(deadline, start + process.config.time_to_stop.value());
+    }
   }
-  logger.Log("All semaphores deleted", Debug);
 
-  logger.Log("Terminating clients", Debug);
-  for (auto& [connection, curr_communication, is_running] :
-       implementation_->clients_) {
-    if (connection.has_value()) {
-      logger.Log("Client is running, closing connection", Debug);
-      try {
-        connection.value().StopClient();
-      } catch (std::exception& exception) {
-        logger.Log("Multithreading tcp connection error", Warning);
+  while (true) {
+    auto now = std::chrono::system_clock::now();
+    std::vector<pollfd> pid_fds;
+    std::vector<Stopping*> polled;
+    auto wait = std::chrono::duration_cast<std::chrono::milliseconds>(
+        kShutdownTimeout);
+    for (auto& process : stopping) {
+      if (process.is_done) {
+        continue;
       }
-      if (curr_communication.has_value()) {
-        logger.Log("Joining client thread", Debug);
-        curr_communication->join();
-        logger.Log("Client thread joined", Debug);
+      if (process.pid_fd == -1 && !IsPidAvailable(process.timing.pid)) {
+        finish(process, SigTerm);
+        continue;
+      }
+      if (now >= process.kill_at) {
+        logger.Log(Info, "Process {} is not stopped in time. Sending SIGKILL",
+                   process.timing.bin_name);
+        KillProcess(process.timing.bin_name, process.timing.pid, SIGKILL);
+        finish(process, SigKill);
+        continue;
+      }
+      wait = std::min(wait,
+                      std::chrono::duration_cast<std::chrono::milliseconds>(
+                          process.kill_at - now) +
+                          std::chrono::milliseconds(1));
+      if (process.pid_fd == -1) {
+        wait = std::min(wait, kShutdownPoll);
       } else {
-        logger.Log("Client is not running", Debug);
+        pid_fds.push_back({.fd = process.pid_fd, .events = POLLIN});
+        polled.push_back(&process);
       }
     }
-  }
-  logger.Log("Clients terminated", Debug);
-  logger.Log("Server deleted", Info);
-}
+    if (std::none_of(stopping.begin(), stopping.end(),
+                     [](const Stopping& process) { return !process.is_done; })) {
+      break;
+    }
 
-/*---------------------------- boot configuration ----------------------------*/
-void LauncherServer::Implementation::GetConfig() noexcept {
-  LServer l_server(LServer::GetConfig, logger_);
-  Logger& logger = l_server;
-  logger.Log("Getting load config", Debug);
+    if (poll(pid_fds.data(), pid_fds.size(), wait.count()) > 0) {
+      for (size_t i = 0; i < pid_fds.size(); ++i) {
+        if (pid_fds[i].revents == 0) {
+          continue;
+        }
+        // leader has exited, the rest of the group is polled
+        close(polled[i]->pid_fd);
+        polled[i]->pid_fd = -1;
+        if (!IsPidAvailable(polled[i]->timing.pid)) {
+          finish(*polled[i], SigTerm);
+        }
+      }
+    }
+  }
 
-  logger.Log("Opening config file", Debug);
-  std::ifstream config(config_file_);
-  if (!config.is_open()) {
-    logger.Log("Error while opening file", Warning);
-    return;
-  } else {
-    logger.Log("File is opened", Debug);
+  logger.Log(Debug, "Closing listening sockets");
+  listeners_m_.lock();
+  for (auto& [bin_name, listeners] : listeners_) {
+    for (int fd : listeners.fds) {
+      close(fd);
+    }
+  }
+  listeners_.clear();
+  listeners_m_.unlock();
+
+  if (!cgroup_root_.empty()) {
+    logger.Log(Debug, "Removing cgroups");
+    std::lock_guard cgroups_lock(cgroups_m_);
+    for (const auto& bin_name : cgroups_) {
+      auto cgroup = GetCgroupPath(bin_name);
+      if (rmdir(cgroup.c_str()) != 0 && errno != ENOENT) {
+        logger.Log(Warning, "Cannot remove cgroup {}: {}", cgroup,
+                   strerror(errno));
+      }
+    }
+    cgroups_.clear();
   }
 
-  int table_size;
-  config >> table_size;
-  logger.Log("Table size got: " + std::to_string(table_size), Debug);
+  std::vector<StopTiming> timings;
+  for (auto& process : stopping) {
+    timings.push_back(std::move(process.timing));
+  }
+  logger.Log(Info, "All processes stopped in {} ms",
+             std::chrono::duration_cast<std::chrono::milliseconds>(
+                 std::chrono::system_clock::now() - start)
+                 .count());
+  return timings;
+}
 
-  logger.Log("Getting configs from file", Debug);
-  for (int i = 0; i < table_size; ++i) {
-    std::string bin_name;
-    ProcessConfig info;
-    config >> bin_name;
+/*--------------------------- state reconciliation ---------------------------*/
+std::vector<LauncherServer::Implementation::DiffEntry>
+LauncherServer::Implementation::DiffState(const BootConfig& desired,
+                                          bool boot_only) noexcept {
+  LServer l_server(LServer::DiffState, logger_);
+  Logger& logger = l_server;
+  logger.Log(Info, "Desired processes: {}", desired.size());
 
-    int arg_num;
-    config >> arg_num;
-    for (int i = 0; i < arg_num; ++i) {
-      std::string arg;
-      config >> arg;
-      info.args.push_back(std::move(arg));
+  logger.Log(Debug, "Locking main, run, term and load mutexes");
+  pr_main_m_.lock();
+  pr_to_run_m_.lock();
+  pr_to_term_m_.lock();
+  load_conf_m_.lock();
+  logger.Log(Debug, "Mutexes locked");
+
+  // running and launching processes which are not being terminated, idle
+  // ones are armed again
+  auto is_stopping = [this](const std::string& bin_name) {
+    auto term_iter = processes_to_terminate_.find(bin_name);
+    return term_iter != processes_to_terminate_.end() &&
+           !term_iter->second.is_idle;
+  };
+  std::map<std::string, const ProcessConfig*> live;
+  for (const auto& [bin_name, process] : processes_) {
+    if (!is_stopping(bin_name)) {
+      live.insert({bin_name, &process.config});
     }
+  }
+  for (const auto& [bin_name, runner] : processes_to_run_) {
+    if (!is_stopping(bin_name)) {
+      live.insert({bin_name, &runner.info.config});
+    }
+  }
 
-    info.launch_on_boot = true;
-    config >> info.term_rerun;
-
-    int delay;
-    config >> delay;
-    if (delay != 0) {
-      info.time_to_stop = std::chrono::milliseconds(delay);
+  std::vector<DiffEntry> diff;
+  for (const auto& [bin_name, config] : load_config_) {
+    if (!desired.contains(bin_name)) {
+      diff.push_back({.bin_name = bin_name, .action = ApplyStop});
+    }
+  }
+  if (!boot_only) {
+    for (const auto& [bin_name, config] : live) {
+      if (!desired.contains(bin_name) && !load_config_.contains(bin_name)) {
+        diff.push_back({.bin_name = bin_name, .action = ApplyStop});
+      }
     }
+  }
 
-    load_config_.insert({std::move(bin_name), std::move(info)});
+  for (const auto& [bin_name, config] : desired) {
+    auto live_iter = live.find(bin_name);
+    auto boot_iter = load_config_.find(bin_name);
+    ApplyAction action;
+    if (live_iter != live.end()) {
+      if (!IsSameRuntime(*live_iter->second, config)) {
+        action = ApplyRestart;
+      } else if (!(*live_iter->second == config) ||
+                 config.launch_on_boot !=
+                     (boot_iter != load_config_.end()) ||
+                 (boot_iter != load_config_.end() &&
+                  !(boot_iter->second == config))) {
+        action = ApplyReconfigure;
+      } else {
+        action = ApplyUnchanged;
+      }
+    } else if (boot_only && boot_iter != load_config_.end() &&
+               boot_iter->second == config) {
+      action = ApplyUnchanged;  // left not running
+    } else {
+      action = ApplyStart;
+    }
+    diff.push_back({.bin_name = bin_name, .action = action, .config = config});
   }
-  logger.Log("Config got, closing file", Debug);
 
-  config.close();
+  load_conf_m_.unlock();
+  pr_to_term_m_.unlock();
+  pr_to_run_m_.unlock();
+  pr_main_m_.unlock();
+  logger.Log(Debug, "Mutexes unlocked. Diff size: {}", diff.size());
+  return diff;
 }
-void LauncherServer::Implementation::SaveConfig() const noexcept {
-  LServer l_server(LServer::SetConfig, logger_);
+std::map<std::string, ApplyResult> LauncherServer::Implementation::ApplyDiff(
+    std::vector<DiffEntry>&& diff, size_t max_parallel,
+    const Deadline& deadline) noexcept {
+  LServer l_server(LServer::ApplyDiff, logger_);
   Logger& logger = l_server;
-  logger.Log("Saving load config", Debug);
 
-  logger.Log("Trying to open file", Debug);
-  std::ofstream config(config_file_);
-  if (!config.is_open()) {
-    logger.Log("Error while opening file", Warning);
-    return;
+  std::vector<ApplyResult> results(diff.size());
+  size_t changes = 0;
+  for (size_t i = 0; i < diff.size(); ++i) {
+    results[i].action = diff[i].action;
+    changes += diff[i].action != ApplyUnchanged;
   }
+  logger.Log(Info, "Applying {} changes", changes);
 
-  logger.Log("Saving table size: " + std::to_string(load_config_.size()),
-             Debug);
-  config << load_config_.size() << "\n";
-
-  logger.Log("Saving configs to file", Debug);
-  for (const auto& [bin_name, process] : load_config_) {
-    if (!process.launch_on_boot) {
-      continue;
+  std::atomic<size_t> next = 0;
+  auto worker = [this, &diff, &results, &next, &deadline] {
+    for (size_t i = next++; i < diff.size(); i = next++) {
+      if (diff[i].action != ApplyUnchanged) {
+        results[i] = ApplyEntry(diff[i], deadline);
+      }
     }
+  };
 
-    config << bin_name << "\t";
+  std::vector<std::thread> workers;
+  size_t workers_num = std::min(std::max<size_t>(max_parallel, 1), changes);
+  for (size_t i = 1; i < workers_num; ++i) {
+    try {
+      workers.emplace_back(worker);
+    } catch (std::system_error& error) {
+      logger.Log(Warning, "Cannot create worker thread: {}", error.what());
+      break;
+    }
+  }
+  worker();
+  for (auto& thread : workers) {
+    thread.join();
+  }
 
-    config << process.args.size() << "\t";
-    for (const auto& arg : process.args) {
-      config << arg << "\t";
+  std::map<std::string, ApplyResult> result;
+  for (size_t i = 0; i < diff.size(); ++i) {
+    result.insert({std::move(diff[i].bin_name), results[i]});
+  }
+  logger.Log(Info, "Changes applied with {} workers", workers.size() + 1);
+  return result;
+}
+ApplyResult LauncherServer::Implementation::ApplyEntry(
+    const DiffEntry& entry, const Deadline& deadline) noexcept {
+  LServer l_server(LServer::ApplyDiff, logger_);
+  Logger& logger = l_server;
+  logger.Log(Info, "Process: {}. Action: {}", entry.bin_name, entry.action);
+
+  ApplyResult result = {.action = entry.action};
+  if (entry.action == ApplyReconfigure) {
+    // reruns and the boot config are taken from the live entry
+    logger.Log(Debug, "Locking main and run mutexes");
+    pr_main_m_.lock();
+    pr_to_run_m_.lock();
+    logger.Log(Debug, "Mutexes main and run locked");
+    std::vector<ProcessConfig*> live;
+    auto main_iter = processes_.find(entry.bin_name);
+    if (main_iter != processes_.end()) {
+      live.push_back(&main_iter->second.config);
+    }
+    auto run_iter = processes_to_run_.find(entry.bin_name);
+    if (run_iter != processes_to_run_.end()) {
+      live.push_back(&run_iter->second.info.config);
+    }
+    for (auto* config : live) {
+      if (!IsSameRuntime(*config, entry.config)) {
+        logger.Log(Warning, "Process has been relaunched with another config");
+        result.is_succeeded = false;
+      }
+    }
+    if (result.is_succeeded && main_iter != processes_.end() &&
+        main_iter->second.config.idle_timeout != entry.config.idle_timeout) {
+      main_iter->second.active = {};  // idle time is counted from the change
+    }
+    if (result.is_succeeded && !live.empty() &&
+        live.front()->launch_limit != entry.config.launch_limit) {
+      std::lock_guard admission_lock(admission_m_);
+      process_buckets_.erase(entry.bin_name);  // refilled with the new burst
+    }
+    if (result.is_succeeded) {
+      for (auto* config : live) {
+        *config = entry.config;
+      }
     }
+    pr_to_run_m_.unlock();
+    pr_main_m_.unlock();
+    logger.Log(Debug, "Mutexes unlocked");
 
-    config << process.term_rerun << "\t";
-    config << (process.time_to_stop.has_value()
-                   ? process.time_to_stop.value().count()
-                   : 0)
-           << "\n";
+    if (result.is_succeeded) {
+      UpdateBootConfig(entry.bin_name, entry.config, logger);
+    }
+    return result;
   }
-  logger.Log("Config saved. Closing file", Debug);
+  if (entry.action == ApplyRestart && entry.config.rolling_restart) {
+    auto status = RollingRestart(std::string(entry.bin_name),
+                                 ProcessConfig(entry.config), deadline);
+    logger.Log(Debug, "Process is restarted with {}", status);
+    result.is_succeeded = status == RunSucceeded;
+    return result;
+  }
+  if (entry.action == ApplyStop || entry.action == ApplyRestart) {
+    auto status = StopProcess(entry.bin_name, true, deadline);
+    logger.Log(Debug, "Process is stopped with {}", status);
+    result.is_succeeded = status != TermError && status != TermTimeout &&
+                          status != TermCancelled;
+  }
+  if (result.is_succeeded &&
+      (entry.action == ApplyStart || entry.action == ApplyRestart)) {
+    auto status = RunProcess(std::string(entry.bin_name),
+                             ProcessConfig(entry.config), true, deadline);
+    logger.Log(Debug, "Process is run with {}", status);
+    result.is_succeeded = status == RunSucceeded;
+  }
+  return result;
+}
+std::map<std::string, ApplyResult>
+LauncherServer::Implementation::ApplyDesiredState(
+    const BootConfig& desired, size_t max_parallel,
+    const Deadline& deadline) noexcept {
+  LServer l_server(LServer::ApplyDesiredState, logger_);
+  Logger& logger = l_server;
+  logger.Log(Info, "Applying desired state: {} processes, {} in parallel",
+             desired.size(), max_parallel);
 
-  config.close();
+  std::lock_guard apply_lock(apply_m_);
+  auto results = ApplyDiff(DiffState(desired, false), max_parallel, deadline);
+  logger.Log(Info, "Desired state applied");
+  return results;
 }
 
 /*----------------------------- thread functions -----------------------------*/
 void LauncherServer::Implementation::Accepter() noexcept {
   LServer l_server(LServer::Accepter, logger_);
   Logger& logger = l_server;
-  logger.Log("Entering loop", Info);
+  logger.Log(Info, "Entering loop");
 
   while (is_active_) {
     TCP::TcpClient* connection;
     try {
-      logger.Log("Trying to accept connection", Info);
+      logger.Log(Info, "Trying to accept connection");
       connection = new TCP::TcpClient(tcp_server_.AcceptConnection());
-      logger.Log("Connection accepted", Info);
+      logger.Log(Info, "Connection accepted");
     } catch (TCP::TcpException& exception) {
       if (exception.GetType() == TCP::TcpException::ConnectionBreak) {
-        logger.Log(
-            "Listener was closed while trying to accept connection, "
-            "terminating thread",
-            Info);
+        logger.Log(Info,
+                   "Listener was closed while trying to accept connection, "
+                   "terminating thread");
         return;
       }
-      logger.Log("Error occurred while trying to accept connection", Warning);
+      logger.Log(Warning, "Error occurred while trying to accept connection");
       continue;
     }
 
-    auto init_receiver = [this, connection](LServer l_server) {
+    auto accepted = std::chrono::system_clock::now();
+    auto init_receiver = [this, connection, accepted](LServer l_server) {
       Logger& logger = l_server;
-      logger.Log("Entering init receiver foo", Info);
+      logger.Log(Info, "Entering init receiver foo");
+      auto started = std::chrono::system_clock::now();
 
       int send_from;
       try {
-        logger.Log("Trying to receive client status", Debug);
+        logger.Log(Debug, "Trying to receive client status");
         if (!connection->Receive(connection->GetMsPingThreshold(), send_from)) {
           throw TCP::TcpException(TCP::TcpException::ConnectionBreak, logger_);
         }
-        logger.Log("Status received: " +
-                       std::string(send_from == SenderStatus::Client ? "Client"
-                                                                     : "Agent"),
-                   Info);
+        logger.Log(Info, "Status received: {}",
+                   send_from == SenderStatus::Client ? "Client" : "Agent");
         if (send_from == SenderStatus::Client) {
-          logger.Log("Locking client mutex", Debug);
+          logger.Log(Debug, "Locking client mutex");
           clients_m_.lock();
-          logger.Log("Client mutex locked", Debug);
+          logger.Log(Debug, "Client mutex locked");
           clients_.push_back({.connection = std::move(*connection)});
           clients_m_.unlock();
-          logger.Log("Client mutex unlocked", Debug);
+          logger.Log(Debug, "Client mutex unlocked");
 
           delete connection;
-          logger.Log("Client inserted to table. Connection closed", Info);
+          logger.Log(Info, "Client inserted to table. Connection closed");
           return;
         }
         if (send_from == SenderStatus::Agent) {
-          // get NAME, PID and ERROR
-          logger.Log("Receiving process config", Debug);
+          // get NAME, PID, ERROR and agent trace timings
+          logger.Log(Debug, "Receiving process config");
           std::string process_name;
           int pid;
           int error;
+          uint64_t trace_id;
+          int64_t agent_started;
+          int64_t agent_connected;
           if (!connection->Receive(connection->GetMsPingThreshold(),
-                                   process_name, pid, error)) {
+                                   process_name, pid, error, trace_id,
+                                   agent_started, agent_connected)) {
             throw TCP::TcpException(TCP::TcpException::ConnectionBreak,
                                     logger_);
           }
-          logger.Log("Config received", Debug);
+          auto received = std::chrono::system_clock::now();
+          logger.Log(Debug, "Config received. Trace id: {}", trace_id);
 
           // block tables to use
-          logger.Log("Locking Run mutex", Debug);
+          logger.Log(Debug, "Locking Run mutex");
           pr_to_run_m_.lock();
-          logger.Log("Mutex Run locked", Debug);
+          logger.Log(Debug, "Mutex Run locked");
 
           // check where is it contained
           bool to_run = processes_to_run_.contains(process_name);
 
           if (!to_run && error == 0) {  // if nowhere
-            logger.Log(
-                "Run table does not contain process, process is in init "
-                "mode. "
-                "Sending kill signal",
-                Warning);
+            logger.Log(Warning,
+                       "Run table does not contain process, process is in "
+                       "init mode. Sending kill signal");
             connection->Send(false);
           } else if (error == 0) {  // if it is init mode
             auto& process = processes_to_run_[process_name];
             if (process.info.pid == 0) {
-              logger.Log("Run table contains process. Process is in init mode",
-                         Info);
+              logger.Log(Info,
+                         "Run table contains process. Process is in init mode");
 
               connection->Send(true);
 
-              process.info.pid = pid;  // set pid : "successful run" flag
-              ProcessChangeSend(true, process.run_semaphore, process.run_status,
-                                logger);
+              RegisterProcess(process_name, process, pid, logger);
+              if (process.last_run.has_value()) {
+                trace_.Record(process.trace.trace_id, "agent start",
+                              process_name, process.last_run.value(),
+                              FromTraceTime(agent_started));
+              }
+              trace_.Record(process.trace.trace_id, "agent connect",
+                            process_name, FromTraceTime(agent_started),
+                            FromTraceTime(agent_connected));
+              trace_.Record(process.trace.trace_id, "accept", process_name,
+                            FromTraceTime(agent_connected), accepted);
+              trace_.Record(process.trace.trace_id, "accepter thread",
+                            process_name, accepted, started);
+              trace_.Record(process.trace.trace_id, "handshake",
+                            process_name, started, received);
             } else {
-              logger.Log("This process is already created", Warning);
+              logger.Log(Warning, "This process is already created");
               connection->Send(false);
             }
           } else {  // error mode
             // do nothing because it will be processed by ctrl
-            logger.Log("Process is in error mode: " + std::to_string(error),
-                       Warning);
+            logger.Log(Warning, "Process is in error mode: {}", error);
           }
 
           // unlock mutexes
           pr_to_run_m_.unlock();
-          logger.Log("Unlocked run mutex", Debug);
+          logger.Log(Debug, "Unlocked run mutex");
         }
       } catch (TCP::TcpException& tcp_exception) {
-        logger.Log("TCP error occurred: " + std::string(tcp_exception.what()),
-                   Warning);
+        logger.Log(Warning, "TCP error occurred: {}", tcp_exception.what());
       }
       delete connection;
     };
 
     try {
-      logger.Log("Creating init receiver thread", Debug);
+      logger.Log(Debug, "Creating init receiver thread");
       std::thread(init_receiver, l_server).detach();
-      logger.Log("Init receiver thread created", Debug);
+      logger.Log(Debug, "Init receiver thread created");
     } catch (std::system_error& error) {
-      logger.Log("Error occurred while creating thread", Warning);
-      logger.Log("Deleting connection", Debug);
+      logger.Log(Warning, "Error occurred while creating thread");
+      logger.Log(Debug, "Deleting connection");
       delete connection;
     }
   }
@@ -793,115 +2798,299 @@ void LauncherServer::Implementation::Accepter() noexcept {
 void LauncherServer::Implementation::Receiver() noexcept {
   LServer l_server(LServer::Receiver, logger_);
   Logger& logger = l_server;
-  logger.Log("Entering loop", Info);
+  logger.Log(Info, "Entering loop");
 
   while (is_active_) {
-    logger.Log("Starting process clients", Info);
+    logger.Log(Info, "Starting process clients");
 
-    logger.Log("Locking client mutex", Debug);
+    logger.Log(Debug, "Locking client mutex");
     clients_m_.lock();
-    logger.Log("Client mutex locked", Debug);
+    logger.Log(Debug, "Client mutex locked");
 
     for (auto iter = clients_.begin(); is_active_ && iter != clients_.end();) {
-      logger.Log("Processing client", Debug);
+      logger.Log(Debug, "Processing client");
       // terminating communication
       if (iter->is_running) {
-        logger.Log("Client thread is running, skip", Debug);
+        logger.Log(Debug, "Client thread is running, skip");
         ++iter;
         continue;
       }
-      logger.Log("Client thread is not running", Debug);
+      logger.Log(Debug, "Client thread is not running");
 
       if (iter->curr_communication.has_value()) {
-        logger.Log("Client thread has been terminated, joining", Debug);
+        logger.Log(Debug, "Client thread has been terminated, joining");
         iter->curr_communication->join();
         iter->curr_communication = {};
       } else {
-        logger.Log("Client thread has not been terminated", Debug);
+        logger.Log(Debug, "Client thread has not been terminated");
       }
 
       if (!iter->connection.has_value()) {
-        logger.Log("Client has been disconnected, erasing", Info);
+        logger.Log(Info, "Client has been disconnected, erasing");
         iter = clients_.erase(iter);
         continue;
       }
-      logger.Log("Client is connected", Debug);
+      logger.Log(Debug, "Client is connected");
 
       try {
-        logger.Log("Checking client message availability", Debug);
+        logger.Log(Debug, "Checking client message availability");
         if (iter->connection->IsAvailable()) {
-          logger.Log("Client message is available. Running thread", Info);
+          logger.Log(Info, "Client message is available. Running thread");
           iter->is_running = true;
+          iter->available = std::chrono::system_clock::now();
           iter->curr_communication =
               std::thread(&LauncherServer::Implementation::ClientCommunication,
                           this, new decltype(iter)(iter));
-          logger.Log("Thread is running", Debug);
+          logger.Log(Debug, "Thread is running");
         }
       } catch (TCP::TcpException& tcp_exception) {
         if (tcp_exception.GetType() == TCP::TcpException::ConnectionBreak) {
-          logger.Log("Client connection broke, erasing", Warning);
+          logger.Log(Warning, "Client connection broke, erasing");
           iter = clients_.erase(iter);
           continue;
         }
-        logger.Log("Got exception while checking message availability:" +
-                       std::string(tcp_exception.what()),
-                   Warning);
+        logger.Log(Warning,
+                   "Got exception while checking message availability:{}",
+                   tcp_exception.what());
       } catch (std::system_error& thread_error) {
-        logger.Log("Error occurred while creating thread: " +
-                       std::string(thread_error.what()),
-                   Warning);
+        logger.Log(Warning, "Error occurred while creating thread: {}",
+                   thread_error.what());
       }
       ++iter;
-      logger.Log("Moving to next process", Debug);
+      logger.Log(Debug, "Moving to next process");
     }
     clients_m_.unlock();
-    logger.Log("Processed all connections. Unlocked client mutex. Sleeping",
-               Info);
+    logger.Log(Info,
+               "Processed all connections. Unlocked client mutex. Sleeping");
     std::this_thread::sleep_for(kLoopWait);
   }
 }
 void LauncherServer::Implementation::ProcessCtrl() noexcept {
   LServer l_server(LServer::ProcessCtrl, logger_);
   Logger& logger = l_server;
-  logger.Log("Entering loop", Info);
+  logger.Log(Info, "Entering loop");
 
   while (is_active_ || !processes_.empty()) {
-    logger.Log("Running Run table processing", Info);
+    auto iteration_start = std::chrono::steady_clock::now();
+    logger.Log(Info, "Running Run table processing");
     PrCtrlToRun();
-    logger.Log("Terminating table processing", Info);
+    logger.Log(Info, "Terminating table processing");
     PrCtrlToTerm();
-    logger.Log("Running Main table processing", Info);
+    logger.Log(Info, "Running Main table processing");
+    auto restarts = restarts_.load(std::memory_order_relaxed);
     PrCtrlMain();
+    if (restarts_.load(std::memory_order_relaxed) != restarts) {
+      logger.Log(Info, "Launching reruns without waiting for the next tick");
+      PrCtrlToRun();
+    }
+    logger.Log(Info, "Retiring table processing");
+    PrCtrlRetiring();
+    CloseUnusedListeners();
+    RemoveUnusedCgroups();
+    logger.Log(Info, "Syncing boot config journal");
+    SyncJournal();
+    CompactConfig();
+    control_loop_.Record(std::chrono::steady_clock::now() - iteration_start);
     std::this_thread::sleep_for(kLoopWait);
   }
 }
 
+void LauncherServer::Implementation::Notifier() noexcept {
+  LServer l_server(LServer::Notifier, logger_);
+  Logger& logger = l_server;
+  if (notify_fd_ == -1) {
+    logger.Log(Info, "No notification socket");
+    return;
+  }
+  logger.Log(Info, "Entering loop");
+
+  while (is_active_) {
+    pollfd notify = {.fd = notify_fd_, .events = POLLIN};
+    if (poll(&notify, 1, kLoopWait.count()) <= 0) {
+      continue;
+    }
+
+    char buffer[4096];
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(ucred))];
+    iovec data = {.iov_base = buffer, .iov_len = sizeof(buffer) - 1};
+    msghdr message = {.msg_iov = &data,
+                      .msg_iovlen = 1,
+                      .msg_control = control,
+                      .msg_controllen = sizeof(control)};
+    ssize_t size = recvmsg(notify_fd_, &message, MSG_DONTWAIT);
+    if (size <= 0) {
+      continue;
+    }
+    cmsghdr* header = CMSG_FIRSTHDR(&message);
+    if (header == nullptr || header->cmsg_level != SOL_SOCKET ||
+        header->cmsg_type != SCM_CREDENTIALS) {
+      logger.Log(Warning, "Notification without credentials ignored");
+      continue;
+    }
+    ucred credentials;
+    std::memcpy(&credentials, CMSG_DATA(header), sizeof(credentials));
+
+    // newline separated assignments
+    std::string_view state(buffer, size);
+    bool is_ready = false;
+    bool is_alive = false;
+    while (!state.empty()) {
+      auto line = state.substr(0, state.find('\n'));
+      state.remove_prefix(std::min(state.size(), line.size() + 1));
+      is_ready |= line == "READY=1";
+      is_alive |= line == "WATCHDOG=1";
+    }
+    logger.Log(Debug, "Notification from {}: {} bytes", credentials.pid,
+               size);
+    // workers of the process are in its process group
+    int group = getpgid(credentials.pid);
+
+    if (is_alive) {
+      auto now = std::chrono::system_clock::now();
+      pr_main_m_.lock();
+      for (auto& [bin_name, info] : processes_) {
+        if (info.pid == credentials.pid || info.pid == group) {
+          logger.Log(Debug, "Heartbeat of {}", bin_name);
+          info.watchdog = now;
+          break;
+        }
+      }
+      pr_main_m_.unlock();
+    }
+    if (!is_ready) {
+      continue;
+    }
+    pr_to_run_m_.lock();
+    for (auto& [bin_name, runner] : processes_to_run_) {
+      if (runner.info.pid == 0 || runner.ready.has_value() ||
+          (runner.info.pid != credentials.pid && runner.info.pid != group)) {
+        continue;
+      }
+      logger.Log(Info, "Process {} is ready", bin_name);
+      runner.ready = std::chrono::system_clock::now();
+      ProcessChangeSend(RunSucceeded, runner.run_semaphore, runner.run_status,
+                        logger);
+      break;
+    }
+    pr_to_run_m_.unlock();
+  }
+}
+
+void LauncherServer::Implementation::Activator() noexcept {
+  LServer l_server(LServer::Activator, logger_);
+  Logger& logger = l_server;
+  logger.Log(Info, "Entering loop");
+
+  struct Watched {
+    std::string bin_name;
+    uint16_t port;
+  };
+  std::vector<pollfd> fds;
+  std::vector<Watched> watched;
+  while (is_active_) {
+    // the set is small and changes with the run table, so it is collected
+    // every iteration instead of keeping an epoll set in sync
+    fds.clear();
+    watched.clear();
+    pr_to_run_m_.lock();
+    listeners_m_.lock();
+    for (const auto& [bin_name, runner] : processes_to_run_) {
+      auto listeners = listeners_.find(bin_name);
+      if (!runner.armed.has_value() || listeners == listeners_.end()) {
+        continue;
+      }
+      const auto& [ports, listen_fds] = listeners->second;
+      for (size_t i = 0; i < listen_fds.size(); ++i) {
+        fds.push_back({.fd = listen_fds[i], .events = POLLIN});
+        watched.push_back({bin_name, i < ports.size() ? ports[i] : uint16_t()});
+      }
+    }
+    listeners_m_.unlock();
+    pr_to_run_m_.unlock();
+
+    if (fds.empty()) {
+      std::this_thread::sleep_for(kLoopWait);
+      continue;
+    }
+    if (poll(fds.data(), fds.size(), kLoopWait.count()) <= 0) {
+      continue;
+    }
+
+    pr_to_run_m_.lock();
+    for (size_t i = 0; i < fds.size(); ++i) {
+      if ((fds[i].revents & POLLIN) == 0) {
+        continue;
+      }
+      const auto& [bin_name, port] = watched[i];
+      auto iter = processes_to_run_.find(bin_name);
+      // sockets may be closed and reused since they were collected
+      if (iter == processes_to_run_.end() || !iter->second.armed.has_value()) {
+        continue;
+      }
+      auto& runner = iter->second;
+      logger.Log(Info, "Connection to {} on port {}. Spawning", bin_name,
+                 port);
+      auto now = std::chrono::system_clock::now();
+      trace_.Record(runner.trace.trace_id, "armed", bin_name,
+                    runner.armed.value(), now);
+      NotifySubscribers(Activated, bin_name, port);
+      runner.armed.reset();
+      runner.queued = now;
+      if (IsUnderPressure(logger) || !Admit(bin_name, runner.info.config)) {
+        logger.Log(Info, "Launch is delayed by admission control");
+        runner.is_throttled = true;
+        throttled_launches_.fetch_add(1, std::memory_order_relaxed);
+        continue;  // launched by the control loop when admitted
+      }
+      // spawned here, not by the next control tick, as the connection waits
+      runner.last_run = now;
+      int pid = SendRun(bin_name, runner.info.config, runner.trace.trace_id);
+      if (pid == -1) {
+        logger.Log(Warning, "Process {} cannot be launched", bin_name);
+        ProcessChangeSend(RunFailed, runner.run_semaphore, runner.run_status,
+                          logger);
+        processes_to_run_.erase(iter);
+        continue;
+      }
+      if (pid != 0) {
+        RegisterProcess(bin_name, runner, pid, logger);
+      }
+    }
+    pr_to_run_m_.unlock();
+  }
+}
+
 void LauncherServer::Implementation::ClientCommunication(
     std::list<Client>::iterator* client) noexcept {
   LServer l_server(LServer::ClientComm, logger_);
   Logger& logger = l_server;
-  logger.Log("Starting communication", Info);
+  logger.Log(Info, "Starting communication");
+  request_timing = {.available = (*client)->available,
+                    .started = std::chrono::system_clock::now()};
 
   try {
-    logger.Log("Trying to receive command", Debug);
+    logger.Log(Debug, "Trying to receive command");
     int command;
     if (!(*client)->connection->Receive(
             (*client)->connection->GetMsPingThreshold(), command)) {
       throw TCP::TcpException(TCP::TcpException::ConnectionBreak, logger_);
     }
-    logger.Log("Command received: " + std::to_string(command), Info);
-    (this->*method_ptr[command])((*client)->connection.value());
+    logger.Log(Info, "Command received: {}", command);
+    if (command < 0 || command >= kNumAMethods) {
+      logger.Log(Warning, "Unknown command, skipping");
+    } else {
+      (this->*method_ptr[command])((*client)->connection.value());
+    }
   } catch (TCP::TcpException& tcp_exception) {
     if (tcp_exception.GetType() == TCP::TcpException::ConnectionBreak) {
       (*client)->connection.reset();
-      logger.Log("Connection broke", Warning);
+      logger.Log(Warning, "Connection broke");
     } else {
-      logger.Log("Error occurred while receiving command: " +
-                     std::string(tcp_exception.what()),
-                 Warning);
+      logger.Log(Warning, "Error occurred while receiving command: {}",
+                 tcp_exception.what());
     }
   }
-  logger.Log("Finishing client connection", Info);
+  logger.Log(Info, "Finishing client connection");
   (*client)->is_running = false;
   delete client;
 }
@@ -910,17 +3099,21 @@ void LauncherServer::Implementation::ClientCommunication(
 void LauncherServer::Implementation::ALoad(TCP::TcpClient& client) {
   LServer l_server(LServer::ALoad, logger_);
   Logger& logger = l_server;
-  logger.Log("Entering loading foo", Info);
+  logger.Log(Info, "Entering loading foo");
 
-  logger.Log("Trying to receive config", Debug);
+  logger.Log(Debug, "Trying to receive config");
   std::string bin_name;
   ProcessConfig config;
   int num_of_args;
   int tmp_time_to_stop;
   bool should_wait;
+  int64_t timeout;
+  uint64_t trace_id;
+  int64_t sent;
   if (!client.Receive(client.GetMsPingThreshold(), bin_name, num_of_args,
                       config.launch_on_boot, config.term_rerun,
-                      tmp_time_to_stop, should_wait)) {
+                      tmp_time_to_stop, should_wait, timeout, trace_id,
+                      sent)) {
     throw TCP::TcpException(TCP::TcpException::ConnectionBreak, logger_);
   }
   for (int i = 0; i < num_of_args; ++i) {
@@ -931,113 +3124,301 @@ void LauncherServer::Implementation::ALoad(TCP::TcpClient& client) {
 
     config.args.push_back(arg);
   }
-  logger.Log("Config received", Debug);
+  if (!ReceiveLaunchOptions(client, config)) {
+    throw TCP::TcpException(TCP::TcpException::ConnectionBreak, logger_);
+  }
+  logger.Log(Debug, "Config received");
 
   if (tmp_time_to_stop != 0) {
     config.time_to_stop = std::chrono::milliseconds(tmp_time_to_stop);
   }
 
-  logger.Log("Running process", Debug);
-  bool result = RunProcess(std::move(bin_name), std::move(config), should_wait);
-  logger.Log("Process has been run, sending result to client", Debug);
+  if (trace_id == 0) {
+    trace_id = NewTraceId();
+  }
+  auto client_sent = FromTraceTime(sent);
+  trace_.Record(trace_id, "client send", bin_name, client_sent,
+                request_timing.available);
+  trace_.Record(trace_id, "client thread", bin_name, request_timing.available,
+                request_timing.started);
+  trace_.Record(trace_id, "request receive", bin_name, request_timing.started,
+                std::chrono::system_clock::now());
+
+  logger.Log(Debug, "Running process. Trace id: {}", trace_id);
+  int result = RunProcess(std::move(bin_name), std::move(config), should_wait,
+                          TimeoutToDeadline(timeout),
+                          {.trace_id = trace_id, .started = client_sent});
+  logger.Log(Debug, "Process has been run, sending result to client");
   client.Send(result);
-  logger.Log("Result sent to client: " + std::to_string(result), Info);
+  logger.Log(Info, "Result sent to client: {}", result);
 }
 
 void LauncherServer::Implementation::AStop(TCP::TcpClient& client) {
   LServer l_server(LServer::AStop, logger_);
   Logger& logger = l_server;
-  logger.Log("Entering stop foo", Info);
+  logger.Log(Info, "Entering stop foo");
 
-  logger.Log("Receiving process config", Debug);
+  logger.Log(Debug, "Receiving process config");
   std::string bin_name;
   bool should_wait;
-  if (!client.Receive(client.GetMsPingThreshold(), bin_name, should_wait)) {
+  int64_t timeout;
+  if (!client.Receive(client.GetMsPingThreshold(), bin_name, should_wait,
+                      timeout)) {
     throw TCP::TcpException(TCP::TcpException::ConnectionBreak, logger_);
   }
 
-  logger.Log("Config received. Terminating process", Debug);
-  int result = StopProcess(bin_name, should_wait);
+  logger.Log(Debug, "Config received. Terminating process");
+  int result = StopProcess(bin_name, should_wait, TimeoutToDeadline(timeout));
 
-  logger.Log("Process has been terminated, sending result to client", Debug);
+  logger.Log(Debug, "Process has been terminated, sending result to client");
   client.Send(result);
-  logger.Log("Result sent to client: " + std::to_string(result), Info);
+  logger.Log(Info, "Result sent to client: {}", result);
 }
 
 void LauncherServer::Implementation::ARerun(TCP::TcpClient& client) {
   LServer l_server(LServer::ARerun, logger_);
   Logger& logger = l_server;
-  logger.Log("Entering Rerun foo", Info);
+  logger.Log(Info, "Entering Rerun foo");
 
-  logger.Log("Receiving process config", Debug);
+  logger.Log(Debug, "Receiving process config");
   std::string bin_name;
   bool should_wait;
-  if (!client.Receive(client.GetMsPingThreshold(), bin_name, should_wait)) {
+  int64_t timeout;
+  if (!client.Receive(client.GetMsPingThreshold(), bin_name, should_wait,
+                      timeout)) {
     throw TCP::TcpException(TCP::TcpException::ConnectionBreak, logger_);
   }
 
-  logger.Log("Config received. Terminating process. Locking mutex", Debug);
-  pr_main_m_.lock();
-  logger.Log("Mutex locked", Debug);
-  if (!processes_.contains(bin_name)) {
-    pr_main_m_.unlock();
-    logger.Log(
-        "Main table does not contain process. Unlocked mutex. Sending result "
-        "to client",
-        Debug);
-
-    client.Send(false);
-    logger.Log("Result sent to client: false. Exit", Info);
-    return;
-  }
-  ProcessConfig config = processes_[bin_name].config;
-  pr_main_m_.unlock();
-  logger.Log(
-      "Main table contains process. Got config. Unlocked mutex. Terminating",
-      Debug);
-
-  StopProcess(bin_name, true);
-  logger.Log("Process terminated. Running process", Debug);
-  bool result = RunProcess(std::move(bin_name), std::move(config), should_wait);
-  logger.Log("Process has been run. Sending result to client", Debug);
+  logger.Log(Debug, "Config received. Rerunning process");
+  int result = RerunProcess(std::move(bin_name), should_wait,
+                            TimeoutToDeadline(timeout));
+  logger.Log(Debug, "Process has been rerun. Sending result to client");
   client.Send(result);
-  logger.Log("Result sent to client: " + std::to_string(result), Info);
+  logger.Log(Info, "Result sent to client: {}", result);
 }
 
 void LauncherServer::Implementation::AIsRunning(TCP::TcpClient& client) {
   LServer l_server(LServer::AIsRunning, logger_);
   Logger& logger = l_server;
-  logger.Log("Entering IsRunning foo", Info);
+  logger.Log(Info, "Entering IsRunning foo");
 
-  logger.Log("Receiving process name", Debug);
+  logger.Log(Debug, "Receiving process name");
   std::string bin_name;
   if (!client.Receive(client.GetMsPingThreshold(), bin_name)) {
     throw TCP::TcpException(TCP::TcpException::ConnectionBreak, logger_);
   }
-  logger.Log("Process name received. Getting PID", Debug);
+  logger.Log(Debug, "Process name received. Getting PID");
 
   bool result = IsRunning(bin_name);
-  logger.Log("Status is got. Sending to client", Debug);
+  logger.Log(Debug, "Status is got. Sending to client");
   client.Send(result);
-  logger.Log("Result sent to client, success", Info);
+  logger.Log(Info, "Result sent to client, success");
 }
 
 void LauncherServer::Implementation::AGetPid(TCP::TcpClient& client) {
   LServer l_server(LServer::AGetPid, logger_);
   Logger& logger = l_server;
-  logger.Log("Entering GetPid foo", Info);
+  logger.Log(Info, "Entering GetPid foo");
 
-  logger.Log("Receiving process name", Debug);
+  logger.Log(Debug, "Receiving process name");
   std::string bin_name;
   if (!client.Receive(client.GetMsPingThreshold(), bin_name)) {
     throw TCP::TcpException(TCP::TcpException::ConnectionBreak, logger_);
   }
-  logger.Log("Process name received. Getting PID", Debug);
+  logger.Log(Debug, "Process name received. Getting PID");
 
   auto result = GetPid(bin_name);
-  logger.Log("PID is got. Sending to client", Debug);
+  logger.Log(Debug, "PID is got. Sending to client");
   client.Send(result.has_value() ? result.value() : 0);
-  logger.Log("Result sent to client, success", Info);
+  logger.Log(Info, "Result sent to client, success");
+}
+
+void LauncherServer::Implementation::ASubscribe(TCP::TcpClient& client) {
+  LServer l_server(LServer::ASubscribe, logger_);
+  Logger& logger = l_server;
+  logger.Log(Info, "Entering Subscribe foo");
+
+  Subscriber subscriber;
+  logger.Log(Debug, "Locking subscribers mutex");
+  std::unique_lock lock(subscribers_m_);
+  auto subscriber_iter = subscribers_.insert(subscribers_.end(), &subscriber);
+  lock.unlock();
+  logger.Log(Debug, "Subscriber registered. Mutex unlocked");
+
+  try {
+    client.Send(true);
+    logger.Log(Info, "Subscription confirmed, streaming events");
+
+    while (is_active_) {
+      lock.lock();
+      subscribers_cv_.wait_for(lock, kLoopWait, [this, &subscriber] {
+        return !is_active_ || !subscriber.events.empty() ||
+               subscriber.lost != 0;
+      });
+      auto events = std::move(subscriber.events);
+      subscriber.events.clear();
+      int lost = subscriber.lost;
+      subscriber.lost = 0;
+      lock.unlock();
+
+      if (events.empty() && lost == 0) {
+        logger.Log(Debug, "No events. Checking connection");
+        client.IsAvailable();
+        continue;
+      }
+
+      logger.Log(Debug, "Sending {} events", events.size());
+      for (const auto& event : events) {
+        client.Send(static_cast<int>(event.type), event.bin_name, event.value);
+      }
+      if (lost != 0) {
+        logger.Log(Warning, "Sending overflow signal: {} events lost", lost);
+        client.Send(static_cast<int>(QueueOverflow), std::string(), lost);
+      }
+    }
+  } catch (TCP::TcpException& tcp_exception) {
+    logger.Log(Warning, "Subscriber connection error, unregistering");
+    lock.lock();
+    subscribers_.erase(subscriber_iter);
+    lock.unlock();
+    throw tcp_exception;
+  }
+
+  logger.Log(Info, "Server is terminating, unregistering subscriber");
+  lock.lock();
+  subscribers_.erase(subscriber_iter);
+  lock.unlock();
+}
+
+void LauncherServer::Implementation::ACancel(TCP::TcpClient& client) {
+  LServer l_server(LServer::ACancel, logger_);
+  Logger& logger = l_server;
+  logger.Log(Info, "Entering Cancel foo");
+
+  logger.Log(Debug, "Receiving process name");
+  std::string bin_name;
+  if (!client.Receive(client.GetMsPingThreshold(), bin_name)) {
+    throw TCP::TcpException(TCP::TcpException::ConnectionBreak, logger_);
+  }
+  logger.Log(Debug, "Process name received. Cancelling waiters");
+
+  bool result = CancelWaits(bin_name);
+  logger.Log(Debug, "Waiters processed. Sending to client");
+  client.Send(result);
+  logger.Log(Info, "Result sent to client: {}", result);
+}
+
+void LauncherServer::Implementation::AGetStats(TCP::TcpClient& client) {
+  LServer l_server(LServer::AGetStats, logger_);
+  Logger& logger = l_server;
+  logger.Log(Info, "Entering GetStats foo");
+
+  logger.Log(Debug, "Collecting stats");
+  auto stats = GetStats();
+  logger.Log(Debug, "Stats collected. Sending to client");
+
+  client.Send(static_cast<int64_t>(stats.uptime.count()), stats.load_config,
+              stats.running, stats.to_run, stats.to_terminate, stats.clients,
+              stats.subscribers, stats.launches, stats.restarts,
+              stats.watchdog_timeouts, stats.idle_stops,
+              stats.throttled_launches);
+  SendLatency(client, stats.spawn_latency);
+  SendLatency(client, stats.stop_latency);
+  SendLatency(client, stats.control_loop);
+
+  client.Send(static_cast<uint64_t>(stats.mutexes.size()));
+  for (const auto& [name, acquisitions, contended] : stats.mutexes) {
+    client.Send(name, acquisitions, contended);
+  }
+  client.Send(static_cast<uint64_t>(stats.actions.size()));
+  for (const auto& [module, action, calls, latency] : stats.actions) {
+    client.Send(module, action, calls);
+    SendLatency(client, latency);
+  }
+  logger.Log(Info, "Result sent to client, success");
+}
+
+void LauncherServer::Implementation::AGetTrace(TCP::TcpClient& client) {
+  LServer l_server(LServer::AGetTrace, logger_);
+  Logger& logger = l_server;
+  logger.Log(Info, "Entering GetTrace foo");
+
+  auto trace = trace_.GetChromeTrace();
+  logger.Log(Debug, "Trace collected: {} bytes. Sending to client",
+             trace.size());
+  client.Send(trace);
+  logger.Log(Info, "Result sent to client, success");
+}
+
+void LauncherServer::Implementation::SendApplyResults(
+    TCP::TcpClient& client,
+    const std::map<std::string, ApplyResult>& results) {
+  client.Send(static_cast<uint64_t>(results.size()));
+  for (const auto& [bin_name, result] : results) {
+    client.Send(bin_name, static_cast<int>(result.action),
+                result.is_succeeded);
+  }
+}
+
+void LauncherServer::Implementation::AReload(TCP::TcpClient& client) {
+  LServer l_server(LServer::AReload, logger_);
+  Logger& logger = l_server;
+  logger.Log(Info, "Entering Reload foo");
+
+  auto results = ReloadConfig();
+  logger.Log(Debug, "Config reloaded. Sending {} results to client",
+             results.size());
+  SendApplyResults(client, results);
+  logger.Log(Info, "Result sent to client, success");
+}
+
+void LauncherServer::Implementation::AApplyState(TCP::TcpClient& client) {
+  LServer l_server(LServer::AApplyState, logger_);
+  Logger& logger = l_server;
+  logger.Log(Info, "Entering apply state foo");
+
+  logger.Log(Debug, "Trying to receive desired state");
+  uint64_t processes_num;
+  uint64_t max_parallel;
+  int64_t timeout;
+  if (!client.Receive(client.GetMsPingThreshold(), processes_num,
+                      max_parallel, timeout)) {
+    throw TCP::TcpException(TCP::TcpException::ConnectionBreak, logger_);
+  }
+  BootConfig desired;
+  for (uint64_t i = 0; i < processes_num; ++i) {
+    std::string bin_name;
+    ProcessConfig config;
+    int num_of_args;
+    int tmp_time_to_stop;
+    if (!client.Receive(client.GetMsPingThreshold(), bin_name, num_of_args,
+                        config.launch_on_boot, config.term_rerun,
+                        tmp_time_to_stop)) {
+      throw TCP::TcpException(TCP::TcpException::ConnectionBreak, logger_);
+    }
+    for (int j = 0; j < num_of_args; ++j) {
+      std::string arg;
+      if (!client.Receive(client.GetMsPingThreshold(), arg)) {
+        throw TCP::TcpException(TCP::TcpException::ConnectionBreak, logger_);
+      }
+      config.args.push_back(arg);
+    }
+    if (!ReceiveLaunchOptions(client, config)) {
+      throw TCP::TcpException(TCP::TcpException::ConnectionBreak, logger_);
+    }
+    if (tmp_time_to_stop != 0) {
+      config.time_to_stop = std::chrono::milliseconds(tmp_time_to_stop);
+    }
+    desired.insert_or_assign(std::move(bin_name), std::move(config));
+  }
+  logger.Log(Debug, "Desired state received: {} processes", desired.size());
+
+  auto results =
+      ApplyDesiredState(desired, max_parallel, TimeoutToDeadline(timeout));
+  logger.Log(Debug, "State applied. Sending {} results to client",
+             results.size());
+  SendApplyResults(client, results);
+  logger.Log(Info, "Result sent to client, success");
 }
 
 }  // namespace LNCR
\ No newline at end of file
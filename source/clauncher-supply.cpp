@@ -1,28 +1,164 @@
 #include "clauncher-supply.hpp"
 
+#include <algorithm>
+#include <atomic>
+
 namespace LNCR {
 
+std::atomic<int> log_priority = Debug;
+
+const size_t kSuppressionSlots = 1024;
+std::atomic<int64_t> suppression_window_ms = 1000;
+std::atomic<int> suppression_burst = 10;
+
+// lossy table: colliding keys evict each other and lose their counters
+struct SuppressionSlot {
+  std::atomic_flag busy;
+  uint64_t key = 0;
+  std::chrono::steady_clock::time_point window_start = {};
+  int passed = 0;
+  int suppressed = 0;
+};
+SuppressionSlot suppression_slots[kSuppressionSlots];
+
+uint64_t MixHash(uint64_t hash, uint64_t value) {
+  return (hash ^ value) * 0x9E3779B97F4A7C15ull + (hash >> 29);
+}
+
+// counts the message in the key's window, reported gets number of messages
+// suppressed in the previous window of the key. If the message is suppressed,
+// carried messages are counted with it
+bool PassSuppression(uint64_t key, int limit,
+                     std::chrono::steady_clock::time_point now,
+                     std::chrono::milliseconds window, int carried,
+                     int& reported) {
+  auto& slot = suppression_slots[key % kSuppressionSlots];
+  while (slot.busy.test_and_set(std::memory_order_acquire)) {
+  }
+  if (slot.key != key || now - slot.window_start >= window) {
+    reported += slot.key == key ? slot.suppressed : 0;
+    slot.key = key;
+    slot.window_start = now;
+    slot.passed = 0;
+    slot.suppressed = 0;
+  }
+  bool is_passed = slot.passed < limit;
+  if (is_passed) {
+    ++slot.passed;
+  } else {
+    slot.suppressed += 1 + carried;
+  }
+  slot.busy.clear(std::memory_order_release);
+  return is_passed;
+}
+
 void LoggerCap(const std::string& l_module, const std::string& l_action,
                const std::string& l_event, int priority) {}
 
-void Logger::Log(const std::string& event, int priority) {
+void SetLogPriority(int priority) noexcept { log_priority = priority; }
+void SetLogSuppression(std::chrono::milliseconds window, int burst) noexcept {
+  suppression_window_ms = window.count();
+  suppression_burst = burst;
+}
+
+Logger::Logger(const logging_foo& logger) : logger_(&logger) {
+  using cap_type = void (*)(const std::string&, const std::string&,
+                            const std::string&, int);
+  auto* target = logger.target<cap_type>();
+  if (!logger || (target != nullptr && *target == LoggerCap)) {
+    return;  // nothing to log to
+  }
+  max_priority_ = std::min(log_priority.load(std::memory_order_relaxed),
+                           kMaxLogPriority);
+}
+bool Logger::IsEnabled(int priority) const noexcept {
+  return priority <= max_priority_;
+}
+std::string& Logger::EventBuffer() noexcept {
+  thread_local std::string event;
+  return event;
+}
+bool Logger::IsSuppressed(std::string_view format, const std::string& event,
+                          int& suppressed) const noexcept {
+  auto window = std::chrono::milliseconds(
+      suppression_window_ms.load(std::memory_order_relaxed));
+  if (window.count() <= 0) {
+    return false;
+  }
+  auto now = std::chrono::steady_clock::now();
+  // call site is the format literal within the action, call id is ignored
+  uint64_t call_site =
+      MixHash(reinterpret_cast<uintptr_t>(format.data()),
+              reinterpret_cast<uintptr_t>(GetAction()));
+  uint64_t message = MixHash(call_site, std::hash<std::string>()(event));
+
+  int message_suppressed = 0;
+  if (!PassSuppression(message, 1, now, window, 0, message_suppressed) ||
+      !PassSuppression(call_site,
+                       suppression_burst.load(std::memory_order_relaxed), now,
+                       window, message_suppressed, suppressed)) {
+    return true;
+  }
+  suppressed += message_suppressed;
+  return false;
+}
+void Logger::Write(std::string_view format, const std::string& event,
+                   int priority) const {
+  int suppressed = 0;
+  if (priority != Error && IsSuppressed(format, event, suppressed)) {
+    return;
+  }
+
+  thread_local std::string module;
+  thread_local std::string action;
+  module = GetModule();
+  action.clear();
   auto id = GetID();
   if (!id.empty()) {
-    id = "( " + id + " ) ";
+    action += "( ";
+    action += id;
+    action += " ) ";
   }
-  logger_(GetModule(), id + GetAction(), event, priority);
+  action += GetAction();
+  if (suppressed != 0) {
+    (*logger_)(module, action,
+               std::to_string(suppressed) + " similar messages suppressed",
+               priority);
+  }
+  (*logger_)(module, action, event, priority);
 }
 std::string Logger::GetID() const { return ""; }
 
-int64_t LServer::calls[24] = {0};
-LServer::LServer(LNCR::LServer::LAction action, logging_foo logger)
-    : action_(action) {
-  logger_ = logger;
-  calls[action_] += 1;
+LServer::ActionMetrics LServer::metrics[ActionsNum];
+LServer::LServer(LNCR::LServer::LAction action, const logging_foo& logger)
+    : Logger(logger),
+      action_(action),
+      id_(metrics[action].calls.fetch_add(1, std::memory_order_relaxed) + 1),
+      start_(std::chrono::steady_clock::now()) {}
+LServer::LServer(const LServer& other)
+    : Logger(other), action_(other.action_), id_(other.id_) {}
+LServer::~LServer() {
+  if (start_.has_value()) {
+    metrics[action_].latency.Record(std::chrono::steady_clock::now() -
+                                    start_.value());
+  }
 }
-std::string LServer::GetModule() const { return "LAUNCHER SERVER"; }
-std::string LServer::GetAction() const {
-  switch (action_) {
+std::vector<ActionStats> LServer::GetStats() {
+  std::vector<ActionStats> stats;
+  stats.reserve(ActionsNum);
+  for (int action = 0; action < ActionsNum; ++action) {
+    stats.push_back(
+        {.module = "LAUNCHER SERVER",
+         .action = GetActionName(static_cast<LAction>(action)),
+         .calls = metrics[action].calls.load(std::memory_order_relaxed),
+         .latency = metrics[action].latency.GetStats()});
+  }
+  return stats;
+}
+const char* LServer::GetModule() const { return "LAUNCHER SERVER"; }
+const char* LServer::GetAction() const { return GetActionName(action_); }
+const char* LServer::GetActionName(LAction action) {
+  switch (action) {
     case Constructor:
       return "CONSTRUCTOR";
     case Destructor:
@@ -71,18 +207,76 @@ std::string LServer::GetAction() const {
       return "PROCESS PID GETTER";
     case IsRunning:
       return "PROCESS RUNNING CHECKER";
+    case ASubscribe:
+      return "(CLIENT) PROCESS EVENTS SUBSCRIBER";
+    case NotifySubscribers:
+      return "PROCESS EVENTS NOTIFIER";
+    case ACancel:
+      return "(CLIENT) WAITERS CANCELLER";
+    case CancelWaits:
+      return "WAITERS CANCELLER";
+    case RerunProcess:
+      return "PROCESS RERUNNER";
+    case AGetStats:
+      return "(CLIENT) STATS GETTER";
+    case AGetTrace:
+      return "(CLIENT) TRACE GETTER";
+    case SyncJournal:
+      return "BOOT CONFIG JOURNAL SYNCER";
+    case CompactConfig:
+      return "BOOT CONFIG COMPACTOR";
+    case UpdateBootConfig:
+      return "BOOT CONFIG UPDATER";
+    case ReloadConfig:
+      return "BOOT CONFIG RELOADER";
+    case AReload:
+      return "(CLIENT) BOOT CONFIG RELOADER";
+    case DiffState:
+      return "STATE DIFFER";
+    case ApplyDiff:
+      return "STATE DIFF APPLIER";
+    case ApplyDesiredState:
+      return "DESIRED STATE APPLIER";
+    case AApplyState:
+      return "(CLIENT) DESIRED STATE APPLIER";
+    case Handover:
+      return "PROCESS HANDOVER SAVER";
+    case AdoptProcesses:
+      return "PROCESS ADOPTER";
+    case Shutdown:
+      return "SERVER SHUTDOWN";
+    case StopAll:
+      return "ALL PROCESSES STOPPER";
+    case RollingRestart:
+      return "ROLLING RESTARTER";
+    case PrCtrlRetiring:
+      return "RETIRING TABLE CONTROLLER";
+    case Listeners:
+      return "LISTENING SOCKETS KEEPER";
+    case Cgroups:
+      return "CGROUP REMOVER";
+    case Notifier:
+      return "NOTIFICATION RECEIVER";
+    case Watchdog:
+      return "WATCHDOG";
+    case Activator:
+      return "SOCKET ACTIVATOR";
+    case Idle:
+      return "IDLE CHECKER";
+    case Spawner:
+      return "PRE-FORKED SPAWNER";
+    case Admission:
+      return "LAUNCH ADMISSION";
     default:
       return "CANNOT RECOGNIZE ACTION";
   }
 }
-std::string LServer::GetID() const { return std::to_string(calls[action_]); }
+std::string LServer::GetID() const { return std::to_string(id_); }
 
-LClient::LClient(LNCR::LClient::LAction action, LNCR::logging_foo logger)
-    : action_(action) {
-  logger_ = logger;
-}
-std::string LClient::GetModule() const { return "LAUNCHER CLIENT"; }
-std::string LClient::GetAction() const {
+LClient::LClient(LNCR::LClient::LAction action, const logging_foo& logger)
+    : Logger(logger), action_(action) {}
+const char* LClient::GetModule() const { return "LAUNCHER CLIENT"; }
+const char* LClient::GetAction() const {
   switch (action_) {
     case Constructor:
       return "CONSTRUCTOR";
@@ -100,25 +294,65 @@ std::string LClient::GetAction() const {
       return "PROCESS PID GETTER";
     case CheckTcpClient:
       return "TCP CLIENT AVAILABILITY CHECKER";
+    case Subscribe:
+      return "PROCESS EVENTS SUBSCRIBER";
+    case CacheUpdater:
+      return "STATUS CACHE UPDATER";
+    case CancelWaits:
+      return "WAITERS CANCELLER";
+    case GetStats:
+      return "STATS GETTER";
+    case GetTrace:
+      return "TRACE GETTER";
+    case ReloadConfig:
+      return "BOOT CONFIG RELOADER";
+    case ApplyDesiredState:
+      return "DESIRED STATE APPLIER";
     default:
       return "CANNOT RECOGNIZE ACTION";
   }
 }
 
-LRunner::LRunner(LNCR::LRunner::LAction action, LNCR::logging_foo logger)
-    : action_(action) {
-  logger_ = logger;
-}
-std::string LRunner::GetModule() const { return "LAUNCHER RUNNER"; }
-std::string LRunner::GetAction() const {
+LRunner::LRunner(LNCR::LRunner::LAction action, const logging_foo& logger)
+    : Logger(logger), action_(action) {}
+const char* LRunner::GetModule() const { return "LAUNCHER RUNNER"; }
+const char* LRunner::GetAction() const {
   switch (action_) {
     case Main:
       return "MAIN";
     case SigHandler:
       return "SIGNAL HANDLER";
+    case Reloader:
+      return "RELOADER";
     default:
       return "CANNOT RECOGNIZE ACTION";
   }
 }
 
+bool ToRunResult(int run_status) {
+  switch (run_status) {
+    case RunTimeout:
+      throw LauncherException(LauncherException::DeadlineExceeded);
+    case RunCancelled:
+      throw LauncherException(LauncherException::Cancelled);
+    default:
+      return run_status == RunSucceeded;
+  }
+}
+
+LauncherException::LauncherException(ExceptionType type) : type_(type) {}
+const char* LauncherException::what() const noexcept {
+  switch (type_) {
+    case DeadlineExceeded:
+      return "deadline exceeded";
+    case Cancelled:
+      return "wait cancelled";
+    default:
+      return "unknown launcher exception";
+  }
+}
+LauncherException::ExceptionType LauncherException::GetType() const noexcept {
+  return type_;
+}
+
 }  // namespace LNCR
\ No newline at end of file
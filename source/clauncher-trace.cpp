@@ -0,0 +1,140 @@
+#include "clauncher-trace.hpp"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <random>
+#include <vector>
+
+namespace LNCR {
+
+const size_t kTraceNameSize = 64;
+
+struct TraceBuffer::Slot {
+  std::atomic_flag busy;
+  bool is_set = false;
+  uint64_t trace_id;
+  const char* phase;
+  int64_t start;
+  int64_t duration;
+  char bin_name[kTraceNameSize];
+  uint16_t bin_name_size;
+};
+
+uint64_t NewTraceId() noexcept {
+  static const uint64_t seed = std::random_device()();
+  static std::atomic<uint64_t> counter = 0;
+  uint64_t id = seed + counter.fetch_add(1, std::memory_order_relaxed) *
+                           0x9E3779B97F4A7C15ull;
+  return id == 0 ? 1 : id;
+}
+int64_t ToTraceTime(
+    std::chrono::time_point<std::chrono::system_clock> time) noexcept {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             time.time_since_epoch())
+      .count();
+}
+std::chrono::time_point<std::chrono::system_clock> FromTraceTime(
+    int64_t time) noexcept {
+  return std::chrono::time_point<std::chrono::system_clock>(
+      std::chrono::duration_cast<std::chrono::system_clock::duration>(
+          std::chrono::microseconds(time)));
+}
+
+void AppendJsonString(std::string& json, std::string_view string) {
+  json += '"';
+  for (char symbol : string) {
+    if (symbol == '"' || symbol == '\\') {
+      json += '\\';
+      json += symbol;
+    } else if (static_cast<unsigned char>(symbol) < 0x20) {
+      char escaped[8];
+      snprintf(escaped, sizeof(escaped), "\\u%04x", symbol);
+      json += escaped;
+    } else {
+      json += symbol;
+    }
+  }
+  json += '"';
+}
+
+TraceBuffer::TraceBuffer(size_t capacity)
+    : capacity_(std::max<size_t>(capacity, 1)),
+      slots_(new Slot[capacity_]) {}
+TraceBuffer::~TraceBuffer() = default;
+
+void TraceBuffer::Record(
+    uint64_t trace_id, const char* phase, const std::string& bin_name,
+    std::chrono::time_point<std::chrono::system_clock> start,
+    std::chrono::time_point<std::chrono::system_clock> end) noexcept {
+  auto& slot = slots_[next_.fetch_add(1, std::memory_order_relaxed) %
+                      capacity_];
+  while (slot.busy.test_and_set(std::memory_order_acquire)) {
+  }
+  slot.is_set = true;
+  slot.trace_id = trace_id;
+  slot.phase = phase;
+  slot.start = ToTraceTime(start);
+  slot.duration = std::max<int64_t>(ToTraceTime(end) - slot.start, 0);
+  slot.bin_name_size = std::min(kTraceNameSize, bin_name.size());
+  std::memcpy(slot.bin_name, bin_name.data(), slot.bin_name_size);
+  slot.busy.clear(std::memory_order_release);
+}
+
+std::string TraceBuffer::GetChromeTrace() const {
+  struct Span {
+    uint64_t trace_id;
+    const char* phase;
+    int64_t start;
+    int64_t duration;
+    std::string bin_name;
+  };
+  std::vector<Span> spans;
+  spans.reserve(capacity_);
+  for (size_t i = 0; i < capacity_; ++i) {
+    auto& slot = slots_[i];
+    while (slot.busy.test_and_set(std::memory_order_acquire)) {
+    }
+    if (slot.is_set) {
+      spans.push_back({slot.trace_id, slot.phase, slot.start, slot.duration,
+                       std::string(slot.bin_name, slot.bin_name_size)});
+    }
+    slot.busy.clear(std::memory_order_release);
+  }
+  std::sort(spans.begin(), spans.end(), [](const Span& a, const Span& b) {
+    return a.start < b.start || (a.start == b.start && a.duration > b.duration);
+  });
+
+  std::string pid = std::to_string(getpid());
+  std::map<uint64_t, int> tracks;
+  std::string json = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+  for (const auto& span : spans) {
+    auto [track, is_new] = tracks.insert({span.trace_id, tracks.size() + 1});
+    if (is_new) {  // name the track after the launch
+      char trace_id[24];
+      snprintf(trace_id, sizeof(trace_id), "%016llx",
+               static_cast<unsigned long long>(span.trace_id));
+      json += "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" + pid +
+              ",\"tid\":" + std::to_string(track->second) +
+              ",\"args\":{\"name\":";
+      AppendJsonString(json, span.bin_name + " " + trace_id);
+      json += "}},";
+    }
+    json += "{\"name\":";
+    AppendJsonString(json, span.phase);
+    json += ",\"cat\":\"launch\",\"ph\":\"X\",\"ts\":" +
+            std::to_string(span.start) +
+            ",\"dur\":" + std::to_string(span.duration) + ",\"pid\":" + pid +
+            ",\"tid\":" + std::to_string(track->second) + "},";
+  }
+  if (json.back() == ',') {
+    json.pop_back();
+  }
+  json += "]}";
+  return json;
+}
+
+}  // namespace LNCR
\ No newline at end of file
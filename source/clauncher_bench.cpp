@@ -0,0 +1,295 @@
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <set>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "clauncher-client.hpp"
+#include "clauncher-metrics.hpp"
+#include "clauncher-server.hpp"
+
+const char kStubArg[] = "--stub";
+const std::chrono::seconds kCallTimeout(30);
+// stops are awaited only with time_to_stop, stubs exit on SIGTERM at once
+const std::chrono::seconds kStubTimeToStop(5);
+
+struct BenchConfig {
+  int port = 14700;
+  std::string agent_binary;
+  int processes = 100;
+  int clients = 8;
+  int polls = 1000;  // per client
+  int rounds = 3;    // reruns of every process
+  std::set<std::string> workloads = {"launch", "poll", "rerun", "stop"};
+};
+
+struct WorkloadResult {
+  std::string name;
+  std::atomic<uint64_t> errors = 0;
+  std::chrono::nanoseconds duration = {};
+  LNCR::LatencyHistogram latency;
+};
+
+void PrintUsage() {
+  fprintf(stderr,
+          "USAGE:\n"
+          "\t--port       > launcher server port (14700)\n"
+          "\t--agent      > agent binary (clauncher_agent next to this one)\n"
+          "\t--processes  > number of stub processes (100)\n"
+          "\t--clients    > number of concurrent clients (8)\n"
+          "\t--polls      > IsProcessRunning / GetProcessPid calls per client "
+          "(1000)\n"
+          "\t--rounds     > reruns of every process (3)\n"
+          "\t--workloads  > comma separated: launch,poll,rerun,stop "
+          "(all)\n");
+}
+
+bool ParseArgs(int argc, char** argv, BenchConfig& config) {
+  if (argc % 2 != 1) {
+    return false;
+  }
+  for (int i = 1; i < argc; i += 2) {
+    std::string name = argv[i], value = argv[i + 1];
+    if (name == "--port") {
+      config.port = std::stoi(value);
+    } else if (name == "--agent") {
+      config.agent_binary = value;
+    } else if (name == "--processes") {
+      config.processes = std::stoi(value);
+    } else if (name == "--clients") {
+      config.clients = std::stoi(value);
+    } else if (name == "--polls") {
+      config.polls = std::stoi(value);
+    } else if (name == "--rounds") {
+      config.rounds = std::stoi(value);
+    } else if (name == "--workloads") {
+      config.workloads.clear();
+      std::stringstream stream(value);
+      std::string workload;
+      while (std::getline(stream, workload, ',')) {
+        config.workloads.insert(workload);
+      }
+    } else {
+      return false;
+    }
+  }
+  return config.processes > 0 && config.clients > 0;
+}
+
+LNCR::Deadline CallDeadline() {
+  return std::chrono::system_clock::now() + kCallTimeout;
+}
+
+// Runs call(client, i) for every i < count, spread over the clients, each
+// client on its own thread. A call failing or throwing counts as an error
+void RunWorkload(
+    std::vector<std::unique_ptr<LNCR::LauncherClient>>& clients, int count,
+    const std::function<bool(LNCR::LauncherClient&, int)>& call,
+    WorkloadResult* result) {
+  auto start = std::chrono::steady_clock::now();
+  std::vector<std::thread> threads;
+  for (size_t client_num = 0; client_num < clients.size(); ++client_num) {
+    threads.emplace_back([&, client_num]() {
+      auto& client = *clients[client_num];
+      for (int i = client_num; i < count; i += clients.size()) {
+        auto call_start = std::chrono::steady_clock::now();
+        bool is_succeeded = false;
+        try {
+          is_succeeded = call(client, i);
+        } catch (std::exception&) {
+        }
+        if (result == nullptr) {
+          continue;
+        }
+        result->latency.Record(std::chrono::steady_clock::now() - call_start);
+        if (!is_succeeded) {
+          result->errors.fetch_add(1, std::memory_order_relaxed);
+        }
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  if (result != nullptr) {
+    result->duration = std::chrono::steady_clock::now() - start;
+  }
+}
+
+double ToMicroseconds(std::chrono::nanoseconds duration) {
+  return std::chrono::duration<double, std::micro>(duration).count();
+}
+
+void PrintLatency(const LNCR::LatencyStats& stats) {
+  std::cout << "{\"mean\":" << ToMicroseconds(stats.mean)
+            << ",\"p50\":" << ToMicroseconds(stats.p50)
+            << ",\"p90\":" << ToMicroseconds(stats.p90)
+            << ",\"p99\":" << ToMicroseconds(stats.p99)
+            << ",\"p999\":" << ToMicroseconds(stats.p999)
+            << ",\"max\":" << ToMicroseconds(stats.max) << "}";
+}
+
+// one JSON document on stdout, latencies in microseconds
+void PrintReport(const BenchConfig& config,
+                 const std::vector<std::unique_ptr<WorkloadResult>>& results,
+                 const LNCR::ServerStats& stats) {
+  std::cout << "{\"processes\":" << config.processes
+            << ",\"clients\":" << config.clients << ",\"workloads\":[";
+  for (size_t i = 0; i < results.size(); ++i) {
+    const auto& result = *results[i];
+    auto latency = result.latency.GetStats();
+    double seconds = std::chrono::duration<double>(result.duration).count();
+    std::cout << (i == 0 ? "" : ",") << "{\"name\":\"" << result.name
+              << "\",\"ops\":" << latency.count
+              << ",\"errors\":" << result.errors.load()
+              << ",\"seconds\":" << seconds << ",\"ops_per_second\":"
+              << (seconds > 0 ? latency.count / seconds : 0)
+              << ",\"latency_us\":";
+    PrintLatency(latency);
+    std::cout << "}";
+  }
+  std::cout << "],\"server\":{\"launches\":" << stats.launches
+            << ",\"restarts\":" << stats.restarts << ",\"spawn_latency_us\":";
+  PrintLatency(stats.spawn_latency);
+  std::cout << ",\"stop_latency_us\":";
+  PrintLatency(stats.stop_latency);
+  std::cout << ",\"control_loop_us\":";
+  PrintLatency(stats.control_loop);
+  std::cout << "}}\n";
+}
+
+int RunBench(const BenchConfig& config) {
+  std::string self = std::filesystem::read_symlink("/proc/self/exe");
+  std::string agent_binary = config.agent_binary;
+  if (agent_binary.empty()) {
+    agent_binary =
+        std::filesystem::path(self).replace_filename("clauncher_agent");
+  }
+
+  char dir_template[] = "/tmp/clauncher_bench.XXXXXX";
+  if (mkdtemp(dir_template) == nullptr) {
+    perror("mkdtemp");
+    return 2;
+  }
+  std::filesystem::path dir = dir_template;
+
+  // every process is a separate name of the stub, which waits for a signal
+  std::vector<std::string> bin_names;
+  for (int i = 0; i < config.processes; ++i) {
+    bin_names.push_back(dir / ("stub_" + std::to_string(i)));
+    std::filesystem::create_symlink(self, bin_names.back());
+  }
+  LNCR::ProcessConfig process_config;
+  process_config.args = {kStubArg};
+  process_config.time_to_stop = kStubTimeToStop;
+
+  std::vector<std::unique_ptr<WorkloadResult>> results;
+  auto workload = [&](const std::string& name) -> WorkloadResult* {
+    if (config.workloads.count(name) == 0) {
+      return nullptr;  // still run as setup or cleanup of other workloads
+    }
+    results.push_back(std::make_unique<WorkloadResult>());
+    results.back()->name = name;
+    return results.back().get();
+  };
+
+  int status = 0;
+  {
+    LNCR::LauncherServer server(config.port, dir / "config", agent_binary);
+    std::vector<std::unique_ptr<LNCR::LauncherClient>> clients;
+    for (int i = 0; i < config.clients; ++i) {
+      clients.push_back(
+          std::make_unique<LNCR::LauncherClient>(config.port));
+    }
+
+    // launch storm: every process at once, each call waits for its run
+    RunWorkload(
+        clients, config.processes,
+        [&](LNCR::LauncherClient& client, int i) {
+          return client.LoadProcess(bin_names[i], process_config, true,
+                                    CallDeadline());
+        },
+        workload("launch"));
+
+    if (config.workloads.count("poll") != 0) {
+      RunWorkload(
+          clients, config.polls * config.clients,
+          [&](LNCR::LauncherClient& client, int i) {
+            const auto& bin_name = bin_names[i % bin_names.size()];
+            if (i % 2 == 0) {
+              return client.IsProcessRunning(bin_name, CallDeadline());
+            }
+            return client.GetProcessPid(bin_name, CallDeadline())
+                .has_value();
+          },
+          workload("poll"));
+    }
+
+    // rerun churn: every process is restarted rounds times
+    if (config.workloads.count("rerun") != 0) {
+      RunWorkload(
+          clients, config.processes * config.rounds,
+          [&](LNCR::LauncherClient& client, int i) {
+            return client.ReRunProcess(bin_names[i % bin_names.size()], true,
+                                       CallDeadline());
+          },
+          workload("rerun"));
+    }
+
+    // stop storm: every process at once, each call waits for its stop
+    RunWorkload(
+        clients, config.processes,
+        [&](LNCR::LauncherClient& client, int i) {
+          auto term_status =
+              client.StopProcess(bin_names[i], true, CallDeadline());
+          return term_status == LNCR::SigTerm ||
+                 term_status == LNCR::SigKill;
+        },
+        workload("stop"));
+
+    PrintReport(config, results, server.GetStats());
+    for (const auto& result : results) {
+      status |= result->errors != 0;
+    }
+    clients.clear();
+    server.Shutdown();
+  }
+
+  std::error_code error;
+  std::filesystem::remove_all(dir, error);
+  return status;
+}
+
+int main(int argc, char** argv) {
+  if (argc == 2 && std::string(argv[1]) == kStubArg) {
+    while (true) {
+      pause();  // terminated by the stop signal
+    }
+  }
+
+  BenchConfig config;
+  try {
+    if (!ParseArgs(argc, argv, config)) {
+      PrintUsage();
+      return 1;
+    }
+  } catch (std::exception&) {
+    PrintUsage();
+    return 1;
+  }
+
+  try {
+    return RunBench(config);
+  } catch (std::exception& error) {
+    perror(error.what());
+    return 2;
+  }
+}
\ No newline at end of file
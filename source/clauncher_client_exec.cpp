@@ -11,11 +11,117 @@ void PrintUsage() {
           "\t- stop  > should wait <\n"
           "\t- rerun > should wait <\n"
           "\t- check <\n"
-          "\t- pid   <\n");
+          "\t- pid   <\n"
+          "\t- cancel <\n"
+          "\t  port\n"
+          "\t- stats\n"
+          "\t- trace\n"
+          "\t- reload\n");
+}
+
+void PrintMetric(const std::string& name, const std::string& type,
+                 const std::string& help) {
+  std::cout << "# HELP " << name << " " << help << "\n";
+  std::cout << "# TYPE " << name << " " << type << "\n";
+}
+void PrintSummary(const std::string& name, const std::string& labels,
+                  const LNCR::LatencyStats& stats) {
+  std::string prefix = labels.empty() ? "" : labels + ",";
+  std::pair<const char*, std::chrono::nanoseconds> quantiles[] = {
+      {"0.5", stats.p50},
+      {"0.9", stats.p90},
+      {"0.99", stats.p99},
+      {"0.999", stats.p999}};
+  for (const auto& [quantile, value] : quantiles) {
+    std::cout << name << "{" << prefix << "quantile=\"" << quantile << "\"} "
+              << std::chrono::duration<double>(value).count() << "\n";
+  }
+  std::string suffix_labels = labels.empty() ? "" : "{" + labels + "}";
+  std::cout << name << "_sum" << suffix_labels << " "
+            << std::chrono::duration<double>(stats.mean).count() * stats.count
+            << "\n";
+  std::cout << name << "_count" << suffix_labels << " " << stats.count
+            << "\n";
+}
+
+// Prometheus text exposition format
+void PrintStats(const LNCR::ServerStats& stats) {
+  PrintMetric("clauncher_uptime_seconds", "gauge",
+              "Time since the launcher server start");
+  std::cout << "clauncher_uptime_seconds "
+            << std::chrono::duration<double>(stats.uptime).count() << "\n";
+
+  PrintMetric("clauncher_processes", "gauge", "Number of processes in table");
+  std::pair<const char*, uint64_t> tables[] = {
+      {"load_config", stats.load_config},
+      {"running", stats.running},
+      {"to_run", stats.to_run},
+      {"to_terminate", stats.to_terminate}};
+  for (const auto& [table, size] : tables) {
+    std::cout << "clauncher_processes{table=\"" << table << "\"} " << size
+              << "\n";
+  }
+
+  PrintMetric("clauncher_clients", "gauge", "Number of connected clients");
+  std::cout << "clauncher_clients " << stats.clients << "\n";
+  PrintMetric("clauncher_subscribers", "gauge",
+              "Number of process events subscribers");
+  std::cout << "clauncher_subscribers " << stats.subscribers << "\n";
+
+  PrintMetric("clauncher_launches_total", "counter", "Agents spawned");
+  std::cout << "clauncher_launches_total " << stats.launches << "\n";
+  PrintMetric("clauncher_launches_per_second", "gauge",
+              "Average agent spawn rate since the server start");
+  std::cout << "clauncher_launches_per_second " << stats.launches_per_second
+            << "\n";
+  PrintMetric("clauncher_restarts_total", "counter",
+              "Exited processes relaunched by term_rerun");
+  std::cout << "clauncher_restarts_total " << stats.restarts << "\n";
+  PrintMetric("clauncher_watchdog_timeouts_total", "counter",
+              "Processes stopped for missed watchdog heartbeats");
+  std::cout << "clauncher_watchdog_timeouts_total " << stats.watchdog_timeouts
+            << "\n";
+  PrintMetric("clauncher_idle_stops_total", "counter",
+              "On demand processes stopped as idle");
+  std::cout << "clauncher_idle_stops_total " << stats.idle_stops << "\n";
+  PrintMetric("clauncher_throttled_launches_total", "counter",
+              "Launches delayed by admission control");
+  std::cout << "clauncher_throttled_launches_total "
+            << stats.throttled_launches << "\n";
+
+  PrintMetric("clauncher_spawn_latency_seconds", "summary",
+              "Agent spawn to handshake latency");
+  PrintSummary("clauncher_spawn_latency_seconds", "", stats.spawn_latency);
+  PrintMetric("clauncher_stop_latency_seconds", "summary",
+              "Stop request to process termination latency");
+  PrintSummary("clauncher_stop_latency_seconds", "", stats.stop_latency);
+  PrintMetric("clauncher_control_loop_seconds", "summary",
+              "Process control loop iteration time");
+  PrintSummary("clauncher_control_loop_seconds", "", stats.control_loop);
+
+  PrintMetric("clauncher_mutex_acquisitions_total", "counter",
+              "Mutex acquisitions");
+  for (const auto& mutex : stats.mutexes) {
+    std::cout << "clauncher_mutex_acquisitions_total{mutex=\"" << mutex.name
+              << "\"} " << mutex.acquisitions << "\n";
+  }
+  PrintMetric("clauncher_mutex_contended_total", "counter",
+              "Mutex acquisitions that waited for the owner");
+  for (const auto& mutex : stats.mutexes) {
+    std::cout << "clauncher_mutex_contended_total{mutex=\"" << mutex.name
+              << "\"} " << mutex.contended << "\n";
+  }
+
+  PrintMetric("clauncher_action_latency_seconds", "summary",
+              "Server action latency");
+  for (const auto& action : stats.actions) {
+    PrintSummary("clauncher_action_latency_seconds",
+                 "action=\"" + action.action + "\"", action.latency);
+  }
 }
 
 int main(int argc, char** argv) {
-  if (argc < 4) {
+  if (argc < 3) {
     PrintUsage();
     return 1;
   }
@@ -23,6 +129,42 @@ int main(int argc, char** argv) {
     LNCR::LauncherClient client(std::stoi(argv[1]));
 
     std::string command = argv[2];
+    if (command == "stats") {
+      if (argc != 3) {
+        PrintUsage();
+        return 1;
+      }
+      PrintStats(client.GetStats());
+      return 0;
+    }
+    if (command == "trace") {
+      if (argc != 3) {
+        PrintUsage();
+        return 1;
+      }
+      std::cout << client.GetTrace();
+      return 0;
+    }
+    if (command == "reload") {
+      if (argc != 3) {
+        PrintUsage();
+        return 1;
+      }
+      const char* kActionNames[] = {"unchanged", "start", "stop", "restart",
+                                    "reconfigure"};
+      int failed = 0;
+      for (const auto& [bin_name, result] : client.ReloadConfig()) {
+        std::cout << bin_name << "\t" << kActionNames[result.action] << "\t"
+                  << (result.is_succeeded ? "ok" : "failed") << "\n";
+        failed += !result.is_succeeded;
+      }
+      return failed == 0 ? 0 : 2;
+    }
+
+    if (argc < 4) {
+      PrintUsage();
+      return 1;
+    }
     std::string bin_path = argv[3];
 
     if (command == "load") {
@@ -83,6 +225,14 @@ int main(int argc, char** argv) {
       std::cout << (pid.has_value() ? pid.value() : 0);
       return 0;
     }
+    if (command == "cancel") {
+      if (argc != 4) {
+        PrintUsage();
+        return 1;
+      }
+      std::cout << client.CancelWaits(bin_path);
+      return 0;
+    }
   } catch (std::exception& error) {
     perror(error.what());
     return 2;
@@ -1,10 +1,158 @@
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/socket.h>
 #include <unistd.h>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
 #include <string>
+#include <vector>
 
 #include "clauncher-supply.hpp"
+#include "clauncher-trace.hpp"
 #include "tcp-client.hpp"
 
+// forks and execs the process of the request, waits for its exec
+LNCR::SpawnReply Spawn(char* request, size_t size,
+                       const std::vector<int>& fds) {
+  LNCR::SpawnHeader header;
+  if (size < sizeof(header)) {
+    return {0, EINVAL};
+  }
+  std::memcpy(&header, request, sizeof(header));
+  std::vector<char*> strings;
+  char* next = request + sizeof(header);
+  char* end = request + size;
+  while (next < end) {
+    auto* zero = static_cast<char*>(std::memchr(next, '\0', end - next));
+    if (zero == nullptr) {
+      return {0, EINVAL};
+    }
+    strings.push_back(next);
+    next = zero + 1;
+  }
+  if (header.args_num == 0 ||
+      strings.size() != 1 + header.args_num + header.env_num) {
+    return {0, EINVAL};
+  }
+  const char* cgroup_procs = strings[0];
+  std::vector<char*> args(strings.begin() + 1,
+                          strings.begin() + 1 + header.args_num);
+  args.push_back(nullptr);
+  std::vector<char*> envp(strings.begin() + 1 + header.args_num,
+                          strings.end());
+
+  // exec closes the write end, the child writes errno if exec fails
+  int error_pipe[2];
+  if (pipe2(error_pipe, O_CLOEXEC) != 0) {
+    return {0, errno};
+  }
+  pid_t pid = fork();
+  if (pid == 0) {
+    // the process starts as if exec'd by the agent: dispositions changed by
+    // the spawner and the inherited signal mask are reset
+    signal(SIGCHLD, SIG_DFL);
+    signal(SIGINT, SIG_DFL);
+    sigset_t empty;
+    sigemptyset(&empty);
+    sigprocmask(SIG_SETMASK, &empty, nullptr);
+    setsid();  // own session and process group, pgid == pid
+    if (cgroup_procs[0] != '\0') {
+      int fd = open(cgroup_procs, O_WRONLY | O_CLOEXEC);
+      if (fd != -1) {
+        write(fd, "0", 1);
+        close(fd);
+      }
+    }
+    // sockets passed by the launcher are for the process itself
+    std::string listen_pid = "LISTEN_PID=" + std::to_string(getpid());
+    std::string watchdog_pid = "WATCHDOG_PID=" + std::to_string(getpid());
+    size_t env_num = envp.size();
+    for (size_t i = 0; i < env_num; ++i) {
+      if (strncmp(envp[i], "LISTEN_FDS=", 11) == 0) {
+        envp.push_back(listen_pid.data());
+      } else if (strncmp(envp[i], "WATCHDOG_USEC=", 14) == 0) {
+        envp.push_back(watchdog_pid.data());
+      }
+    }
+    envp.push_back(nullptr);
+    // listening sockets to 3, 4, ... moving them above the targets first;
+    // everything else of the spawner is close-on-exec
+    std::vector<int> moved_fds(fds.size());
+    for (size_t i = 0; i < fds.size(); ++i) {
+      moved_fds[i] = fcntl(fds[i], F_DUPFD_CLOEXEC, 3 + fds.size());
+    }
+    for (size_t i = 0; i < moved_fds.size(); ++i) {
+      dup2(moved_fds[i], 3 + i);
+    }
+    execve(args[0], args.data(), envp.data());
+    int error = errno;
+    write(error_pipe[1], &error, sizeof(error));
+    _exit(127);
+  }
+  int fork_error = errno;
+  close(error_pipe[1]);
+  if (pid == -1) {
+    close(error_pipe[0]);
+    return {0, fork_error};
+  }
+  int error = 0;
+  while (read(error_pipe[0], &error, sizeof(error)) < 0 && errno == EINTR) {
+  }
+  close(error_pipe[0]);
+  return {pid, error};
+}
+
+// serves spawn requests until the server closes its end
+int RunSpawner() {
+  fcntl(LNCR::kSpawnerFd, F_SETFD, FD_CLOEXEC);
+  signal(SIGCHLD, SIG_IGN);  // spawned processes are reaped by the kernel
+  signal(SIGINT, SIG_IGN);   // stops with the server, not with its terminal
+
+  std::vector<char> request(LNCR::kSpawnRequestMax);
+  alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int) * LNCR::kSpawnFdsMax)];
+  while (true) {
+    iovec data = {.iov_base = request.data(), .iov_len = request.size()};
+    msghdr message = {.msg_iov = &data,
+                      .msg_iovlen = 1,
+                      .msg_control = control,
+                      .msg_controllen = sizeof(control)};
+    ssize_t size = recvmsg(LNCR::kSpawnerFd, &message, MSG_CMSG_CLOEXEC);
+    if (size < 0 && errno == EINTR) {
+      continue;
+    }
+    if (size <= 0) {
+      return 0;
+    }
+    std::vector<int> fds;
+    for (cmsghdr* header = CMSG_FIRSTHDR(&message); header != nullptr;
+         header = CMSG_NXTHDR(&message, header)) {
+      if (header->cmsg_level == SOL_SOCKET &&
+          header->cmsg_type == SCM_RIGHTS) {
+        size_t fds_num = (header->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+        size_t begin = fds.size();
+        fds.resize(begin + fds_num);
+        std::memcpy(fds.data() + begin, CMSG_DATA(header),
+                    fds_num * sizeof(int));
+      }
+    }
+
+    auto reply = Spawn(request.data(), size, fds);
+    for (int fd : fds) {
+      close(fd);
+    }
+    if (send(LNCR::kSpawnerFd, &reply, sizeof(reply), MSG_NOSIGNAL) !=
+        sizeof(reply)) {
+      return 0;
+    }
+  }
+}
+
 int main(const int argc, char** argv) {
+  int64_t started = LNCR::ToTraceTime(std::chrono::system_clock::now());
+  if (argc == 2 && strcmp(argv[1], LNCR::kSpawnerArg) == 0) {
+    return RunSpawner();
+  }
   if (argc < 3) {
     return 1;
   }
@@ -12,10 +160,19 @@ int main(const int argc, char** argv) {
   int port;
   sscanf(argv[1], "%d", &port);
 
+  uint64_t trace_id = 0;
+  if (const char* env_trace_id = getenv(LNCR::kTraceIdEnv)) {
+    trace_id = strtoull(env_trace_id, nullptr, 10);
+    unsetenv(LNCR::kTraceIdEnv);
+  }
+  int64_t connected = 0;
+
   try {
     TCP::TcpClient tcp_client("127.0.0.1", port);
+    connected = LNCR::ToTraceTime(std::chrono::system_clock::now());
     tcp_client.Send(static_cast<int>(LNCR::Agent));
-    tcp_client.Send(std::string(argv[2]), getpid(), 0);
+    tcp_client.Send(std::string(argv[2]), getpid(), 0, trace_id, started,
+                    connected);
 
     bool should_run;
     if (!tcp_client.Receive(tcp_client.GetMsPingThreshold(), should_run) ||
@@ -26,6 +183,14 @@ int main(const int argc, char** argv) {
     return 2;
   }
 
+  // sockets passed by the launcher are for the process itself
+  if (getenv("LISTEN_FDS") != nullptr) {
+    setenv("LISTEN_PID", std::to_string(getpid()).c_str(), 1);
+  }
+  if (getenv("WATCHDOG_USEC") != nullptr) {
+    setenv("WATCHDOG_PID", std::to_string(getpid()).c_str(), 1);
+  }
+
   char* args[argc - 1];
 
   args[0] = argv[2];
@@ -35,11 +200,13 @@ int main(const int argc, char** argv) {
   args[argc - 2] = NULL;
 
   execv(args[0], args);
+  int error = errno;
 
   try {
-    TCP::TcpClient tcp_client("127.0.0.1", 0);
+    TCP::TcpClient tcp_client("127.0.0.1", port);
     tcp_client.Send(static_cast<int>(LNCR::Agent));
-    tcp_client.Send(std::string(argv[2]), getpid(), errno);
+    tcp_client.Send(std::string(argv[2]), getpid(), error, trace_id, started,
+                    connected);
   } catch (...) {
     return 3;
   }